@@ -0,0 +1,74 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <cstdlib>
+
+#include "chess/chess_game_state.h"
+#include "chess/chess_game_logic.h"
+#include "chess/chess_mcts.h"
+#include "chess/chess_heuristic_evaluator.h"
+#include "chess/chess_native_net.h"
+#include "chess/chess_native_quantize.h"
+
+using namespace std;
+
+/**
+ * Benchmarks ChessNetMCTS with the heuristic stand-in evaluator, or with
+ * the native network if a weights file is given (neither requires
+ * TensorFlow). Usage:
+ *
+ *   ./bin/bench_mcts [sims per move] [evaluator latency (us)] [# of moves] [native weights] [dataset]
+ *
+ * The native net is checked against the reference outputs stored in the
+ * weights file when it is loaded (the max errors are reported on stderr).
+ * If a dataset file is also given, the native net is quantized to int8
+ * (calibrated on positions from the dataset), and its agreement with the
+ * float net is reported (on stderr). The search and inference stats are
+ * printed as JSON.
+ */
+int main(int argc, char** argv){
+
+    unsigned int sims_per_move = (argc > 1)? atoi(argv[1]) : 256;
+    double latency = (argc > 2)? atof(argv[2]) * 1.0E-6 : 0.0;
+    unsigned int n_moves = (argc > 3)? atoi(argv[3]) : 20;
+
+    shared_ptr<ChessNetEvaluator> evaluator;
+    if(argc > 4){
+        auto net = load_chessnet_native(argv[4]);
+        if(!net){ return 1; }
+        auto& parity = net->get_parity_report();
+        cerr << "Native net vs. SavedModel (" << parity.n_samples << " reference samples):"
+             << " max policy error " << parity.policy_error_max
+             << ", max value error " << parity.value_error_max << endl;
+        if(argc > 5){
+            ChessNetDatasetFile data = ChessNetDatasetFile(argv[5]);
+            if(!data.is_open() || data.size() == 0){ return 1; }
+            auto quantized_net = quantize_chessnet_native(*net, data);
+            cerr << compare_chessnet_native(*net, *quantized_net, data).to_json() << endl;
+            net = quantized_net;
+        }
+        evaluator = make_shared<ChessNativeEvaluator>(net);
+    } else {
+        evaluator = make_shared<ChessHeuristicEvaluator>(latency);
+    }
+    ChessNetMCTS mcts = ChessNetMCTS(GameState(), evaluator);
+
+    // play the most visited move at each step:
+    vector<move_vector> actions;
+    vector<double> probs;
+    for(unsigned int n = 0; n < n_moves; ++n){
+        if(!mcts.get_state_actions(actions)){ break; }
+
+        mcts.run(sims_per_move);
+        mcts.get_state_action_distribution(probs);
+
+        unsigned int best = 0;
+        for(unsigned int i = 1; i < probs.size(); ++i){
+            if(probs[i] > probs[best]){ best = i; }
+        }
+        mcts.apply_state_action(actions[best]);
+    }
+
+    cout << mcts.stats_to_json() << endl;
+    return 0;
+}
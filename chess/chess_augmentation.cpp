@@ -0,0 +1,52 @@
+#include <cstring>
+
+#include "chess_augmentation.h"
+
+template<typename P>
+static bool may_castle_board(const P* board){
+    return (board[4] == W_KING && (board[0] == W_ROOK || board[7] == W_ROOK)) ||
+           (board[60] == B_KING && (board[56] == B_ROOK || board[63] == B_ROOK));
+}
+
+bool may_castle(const piece* board){
+    return may_castle_board(board);
+}
+
+bool may_castle(const int8_t* board){
+    return may_castle_board(board);
+}
+
+chessnet_symmetry sample_symmetry(unsigned int augmentation, default_random_engine& rng){
+    if(augmentation == AUGMENT_NONE){
+        return SYM_IDENTITY;
+    }
+
+    // choose uniformly among the enabled symmetries (including the identity):
+    unsigned int s;
+    do {
+        s = rng() & 0x3;
+    } while(s & ~augmentation);
+    return static_cast<chessnet_symmetry>(s);
+}
+
+template<typename P>
+static void encode_board_symmetry(const P* board, chessnet_symmetry s, float* x){
+    // (a colour flip swaps the colours, i.e. negates the planes)
+    float c = (s & SYM_COLOR_FLIP)? -1.0f : 1.0f;
+    for(unsigned int k = 0; k < 64; ++k){
+        float* dest = x + symmetry_square(s, k)*BOARD_PLANES;
+        memset(dest, 0, BOARD_PLANES*sizeof(float));
+        int p = board[k] & 0xF;
+        if(p >= W_PAWN && p <= B_KING){
+            dest[(p>>1)-1] = (p & 1)? -c : c;
+        }
+    }
+}
+
+void encode_board(const piece* board, chessnet_symmetry s, float* x){
+    encode_board_symmetry(board, s, x);
+}
+
+void encode_board(const int8_t* board, chessnet_symmetry s, float* x){
+    encode_board_symmetry(board, s, x);
+}
@@ -0,0 +1,66 @@
+#ifndef CHESS_AUGMENTATION_H
+#define CHESS_AUGMENTATION_H
+
+#include <cstdint>
+#include <random>
+
+#include "chess_board_encoder.h"
+
+using namespace std;
+
+// board symmetries (bit 0: mirror files, bit 1: flip colours):
+enum chessnet_symmetry : uint8_t {
+    SYM_IDENTITY = 0,
+    SYM_MIRROR = 1,
+    SYM_COLOR_FLIP = 2,
+    SYM_MIRROR_COLOR_FLIP = 3
+};
+
+// enabled augmentations (flags):
+const unsigned int AUGMENT_NONE = 0;
+const unsigned int AUGMENT_MIRROR = SYM_MIRROR;
+const unsigned int AUGMENT_COLOR_FLIP = SYM_COLOR_FLIP;
+const unsigned int AUGMENT_ALL = AUGMENT_MIRROR | AUGMENT_COLOR_FLIP;
+
+/**
+ * Training examples are transformed as they are packed, by writing each
+ * element at its remapped index (square k = 8*y + x, move index = 64*src + dest):
+ *
+ *   mirror:      x -> 7-x (only valid if neither side can castle)
+ *   colour flip: y -> 7-y, white <-> black (the planes are negated), and
+ *                the value is negated (values are from white's perspective)
+ */
+inline unsigned int symmetry_square(chessnet_symmetry s, unsigned int k){
+    if(s & SYM_MIRROR){ k ^= 0x7; }
+    if(s & SYM_COLOR_FLIP){ k ^= 0x38; }
+    return k;
+}
+
+inline unsigned int symmetry_move_index(chessnet_symmetry s, unsigned int idx){
+    return (symmetry_square(s, idx >> 6) << 6) | symmetry_square(s, idx & 63);
+}
+
+// the value of a position under the symmetry s:
+inline float symmetry_value(chessnet_symmetry s, float v){
+    return (s & SYM_COLOR_FLIP)? -v : v;
+}
+
+// true if a king and rook of the same colour are on their initial squares of the board:
+bool may_castle(const piece* board);
+bool may_castle(const int8_t* board);
+
+// s without the mirror, if it is not valid for the board:
+template<typename P>
+inline chessnet_symmetry valid_symmetry(chessnet_symmetry s, const P* board){
+    return ((s & SYM_MIRROR) && may_castle(board))? static_cast<chessnet_symmetry>(s & ~SYM_MIRROR) : s;
+}
+
+// picks a random symmetry among the enabled augmentations. The mirror is dropped when the item
+// is packed if it is not valid for the item's board (which leaves a uniform choice among the valid ones):
+chessnet_symmetry sample_symmetry(unsigned int augmentation, default_random_engine& rng);
+
+// encodes the board under the symmetry s (see encode_board), writing each square once:
+void encode_board(const piece* board, chessnet_symmetry s, float* x);
+void encode_board(const int8_t* board, chessnet_symmetry s, float* x);
+
+#endif /* CHESS_AUGMENTATION_H */
@@ -0,0 +1,83 @@
+#include <cassert>
+
+#include "chess_batch_stream.h"
+
+ChessNetBatchStream::ChessNetBatchStream(ChessNetDataSource& source,
+                        vector<unsigned int> idxs,
+                        unsigned int batch_size,
+                        unsigned int augmentation,
+                        unsigned int seed,
+                        unsigned int queue_capacity) :
+                        source(source), queue(queue_capacity) {
+    assert(batch_size > 0);
+
+    this->idxs = idxs;
+    this->batch_size = batch_size;
+    this->augmentation = augmentation;
+    this->seed = seed;
+    this->producer_error = nullptr;
+
+    producer = thread(&ChessNetBatchStream::produce_batches, this);
+}
+
+ChessNetBatchStream::~ChessNetBatchStream(){
+    // unblock and stop the producer (if it is still running):
+    queue.close();
+    if(producer.joinable()){
+        producer.join();
+    }
+}
+
+void ChessNetBatchStream::produce_batches(){
+
+    // reusable packing buffers:
+    auto batch_x = vector<float>(batch_size*8*8*6);
+    auto batch_y_pi = vector<float>(batch_size*64*64);
+    auto batch_y_v = vector<float>(batch_size);
+    int64_t n = batch_size;
+
+    auto rng = default_random_engine(seed);
+
+    try {
+        for(unsigned int i = 0; i + batch_size <= idxs.size(); i += batch_size){
+
+            // pack x: [batch size,8,8,6], y_pi: [batch size, 64*64], y_v: [batch size]
+            for(unsigned int j = 0; j < batch_size; ++j){
+                source.pack_item(idxs[i+j],
+                                 &batch_x[j*8*8*6],
+                                 &batch_y_pi[j*64*64],
+                                 &batch_y_v[j],
+                                 sample_symmetry(augmentation, rng));
+            }
+
+            // copy buffers into tensors and hand them to the consumer:
+            chessnet_batch batch = {
+                cppflow::tensor(batch_x, {n, 8,8,6}),
+                cppflow::tensor(batch_y_pi, {n, 64*64}),
+                cppflow::tensor(batch_y_v, {n})
+            };
+            if(!queue.push(move(batch))){
+                break;
+            }
+        }
+    } catch(...) {
+        producer_error = current_exception();
+    }
+
+    queue.close();
+}
+
+bool ChessNetBatchStream::next(chessnet_batch& batch){
+    if(queue.pop(batch)){
+        return true;
+    }
+
+    // re-throw any error raised while packing:
+    if(producer.joinable()){
+        producer.join();
+    }
+    if(producer_error){
+        rethrow_exception(producer_error);
+    }
+    return false;
+}
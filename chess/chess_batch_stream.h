@@ -0,0 +1,65 @@
+#ifndef CHESS_BATCH_STREAM_H
+#define CHESS_BATCH_STREAM_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <exception>
+
+#include "chess_dataset.h"
+#include "chess_augmentation.h"
+#include "cppflow/tensor.h"
+#include "util/bounded_queue.h"
+
+struct chessnet_batch {
+    cppflow::tensor x;      // [batch size,8,8,6]
+    cppflow::tensor y_pi;   // [batch size,64*64]
+    cppflow::tensor y_v;    // [batch size]
+};
+
+/**
+ * Streams minibatches of a data source to the training loop.
+ *
+ *  A producer thread packs the items at the given indices into reusable
+ *  buffers (batch_size items per batch, any incomplete final batch is dropped)
+ *  and hands the resulting tensors over through a bounded queue, so batch
+ *  packing overlaps with the train step and at most queue_capacity
+ *  batches are held in memory at once.
+ *
+ *  If augmentation is enabled, each item is packed under a random board
+ *  symmetry (see chess_augmentation.h), drawn from the given seed.
+ */
+class ChessNetBatchStream {
+private:
+    ChessNetDataSource& source;
+    vector<unsigned int> idxs;
+    unsigned int batch_size;
+    unsigned int augmentation;
+    unsigned int seed;
+
+    util::bounded_queue<chessnet_batch> queue;
+    thread producer;
+    exception_ptr producer_error;
+
+    void produce_batches();
+
+public:
+    ChessNetBatchStream(ChessNetDataSource& source,
+                        vector<unsigned int> idxs,
+                        unsigned int batch_size,
+                        unsigned int augmentation = AUGMENT_NONE,
+                        unsigned int seed = 0,
+                        unsigned int queue_capacity = 4);
+
+    ChessNetBatchStream(const ChessNetBatchStream&) = delete;
+    ChessNetBatchStream& operator=(const ChessNetBatchStream&) = delete;
+
+    ~ChessNetBatchStream();
+
+    // blocks until the next batch is ready; returns false once all batches are consumed:
+    bool next(chessnet_batch& batch);
+
+    unsigned int get_n_batches(){ return idxs.size() / batch_size; }
+};
+
+#endif /* CHESS_BATCH_STREAM_H */
@@ -0,0 +1,37 @@
+#include <cstring>
+
+#include "chess_board_encoder.h"
+
+// piece code -> plane values (codes outside of the piece enum encode as empty squares):
+struct piece_plane_table {
+    float rows[16][BOARD_PLANES];
+
+    constexpr piece_plane_table() : rows() {
+        for(int p = W_PAWN; p <= B_KING; ++p){
+            rows[p][(p>>1)-1] = (p & 1)? -1.0f : 1.0f;
+        }
+    }
+};
+
+static constexpr piece_plane_table PIECE_PLANES;
+
+template<typename P>
+static inline void encode_squares(const P* board, float* x){
+    for(unsigned int k = 0; k < 64; ++k){
+        memcpy(x + k*BOARD_PLANES, PIECE_PLANES.rows[board[k] & 0xF], sizeof(PIECE_PLANES.rows[0]));
+    }
+}
+
+void encode_board(const piece* board, float* x){
+    encode_squares(board, x);
+}
+
+void encode_board(const int8_t* board, float* x){
+    encode_squares(board, x);
+}
+
+void encode_boards(const array<piece,64>* boards, size_t n_boards, float* x){
+    for(size_t i = 0; i < n_boards; ++i){
+        encode_squares(boards[i].data(), x + i*BOARD_ENCODING_SIZE);
+    }
+}
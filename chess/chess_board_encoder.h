@@ -0,0 +1,30 @@
+#ifndef CHESS_BOARD_ENCODER_H
+#define CHESS_BOARD_ENCODER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "chess_game_state.h"
+
+using namespace std;
+
+/**
+ * Network input encoding of a board (8x8x6, NHWC):
+ *
+ *   x[6*k + (p>>1)-1] = +1 (white) or -1 (black)
+ *
+ *  for the piece p on square k (k = 8*y + x), and 0 elsewhere. Each square
+ *  is written by copying one row of a piece-to-plane lookup table, so the
+ *  encoding is branch-free and every square is a fixed-size block copy.
+ */
+const unsigned int BOARD_PLANES = 6;
+const unsigned int BOARD_ENCODING_SIZE = 8*8*BOARD_PLANES;
+
+void encode_board(const piece* board, float* x);
+void encode_board(const int8_t* board, float* x);
+
+// encodes n_boards boards into consecutive blocks of BOARD_ENCODING_SIZE floats:
+void encode_boards(const array<piece,64>* boards, size_t n_boards, float* x);
+
+#endif /* CHESS_BOARD_ENCODER_H */
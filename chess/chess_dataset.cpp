@@ -0,0 +1,172 @@
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <cassert>
+#include <iostream>
+
+#include "chess_dataset.h"
+#include "chess_board_encoder.h"
+
+void ChessNetMemoryDataSource::pack_item(size_t idx, float* x, float* y_pi, float* y_v,
+                                         chessnet_symmetry s){
+    assert(idx < data.size());
+
+    // retrieve data element tuple: (board, pi_probs, value)
+    auto& [elem_board, elem_probs, elem_value] = data[idx];
+
+    s = valid_symmetry(s, elem_board.data());
+    if(s == SYM_IDENTITY){
+        encode_board(elem_board.data(), x);
+    } else {
+        encode_board(elem_board.data(), s, x);
+    }
+    for(unsigned int k = 0; k < 64*64; ++k){
+        y_pi[symmetry_move_index(s, k)] = (isnan(elem_probs[k]))? 0.0f : static_cast<float>(elem_probs[k]);
+    }
+    *y_v = symmetry_value(s, static_cast<float>(elem_value));
+}
+
+ChessNetDatasetFile::ChessNetDatasetFile(string path){
+    this->path = path;
+    this->records = nullptr;
+    this->n_records = 0;
+    reload();
+}
+
+bool ChessNetDatasetFile::reload(){
+
+    records = nullptr;
+    n_records = 0;
+
+    if(!file.open(path) || file.size() < sizeof(chessnet_file_header)){
+        cerr << "Error: unable to open \"" + path + "\"." << endl;
+        file.close();
+        return false;
+    }
+
+    // validate header:
+    chessnet_file_header header;
+    memcpy(&header, file.data(), sizeof(header));
+    if(memcmp(header.magic, CHESSNET_FILE_MAGIC, sizeof(header.magic)) ||
+       header.version != CHESSNET_FILE_VERSION ||
+       header.record_size != sizeof(chessnet_record)){
+        cerr << "Error: \"" + path + "\" is not a valid dataset file." << endl;
+        file.close();
+        return false;
+    }
+
+    // only expose records that were completely written:
+    size_t max_records = (file.size() - sizeof(header)) / sizeof(chessnet_record);
+    n_records = (header.n_records < max_records)? header.n_records : max_records;
+    records = reinterpret_cast<const chessnet_record*>(file.data() + sizeof(header));
+    file.advise_random();
+
+    return true;
+}
+
+void ChessNetDatasetFile::get_item(size_t idx, array<piece,64>& board,
+                                   array<double,64*64>& probs, double& value){
+    assert(idx < n_records);
+    const chessnet_record& r = records[idx];
+    for(unsigned int k = 0; k < 64; ++k){ board[k] = static_cast<piece>(r.board[k]); }
+    for(unsigned int k = 0; k < 64*64; ++k){ probs[k] = r.probs[k]; }
+    value = r.value;
+}
+
+void ChessNetDatasetFile::pack_item(size_t idx, float* x, float* y_pi, float* y_v,
+                                    chessnet_symmetry s){
+    assert(idx < n_records);
+    pack_chessnet_record(records[idx], x, y_pi, y_v, s);
+}
+
+void pack_chessnet_record(const chessnet_record& r, float* x, float* y_pi, float* y_v,
+                          chessnet_symmetry s){
+    s = valid_symmetry(s, r.board);
+    if(s == SYM_IDENTITY){
+        encode_board(r.board, x);
+        memcpy(y_pi, r.probs, sizeof(r.probs));
+        *y_v = r.value;
+        return;
+    }
+
+    encode_board(r.board, s, x);
+    for(unsigned int k = 0; k < 64*64; ++k){
+        y_pi[symmetry_move_index(s, k)] = r.probs[k];
+    }
+    *y_v = symmetry_value(s, r.value);
+}
+
+bool append_chessnet_dataset_file(chessnet_dataset& data, string path){
+
+    FILE* file_out = fopen(path.c_str(), "r+b");
+    if(!file_out){
+        file_out = fopen(path.c_str(), "w+b");
+    }
+    if(!file_out){
+        cerr << "Error: unable to open \"" + path + "\"." << endl;
+        return false;
+    }
+
+    // read (or initialize) the header:
+    chessnet_file_header header;
+    if(fread(&header, sizeof(header), 1, file_out) != 1){
+        memcpy(header.magic, CHESSNET_FILE_MAGIC, sizeof(header.magic));
+        header.version = CHESSNET_FILE_VERSION;
+        header.record_size = sizeof(chessnet_record);
+        header.n_records = 0;
+    } else if(memcmp(header.magic, CHESSNET_FILE_MAGIC, sizeof(header.magic)) ||
+              header.version != CHESSNET_FILE_VERSION ||
+              header.record_size != sizeof(chessnet_record)){
+        cerr << "Error: \"" + path + "\" is not a valid dataset file." << endl;
+        fclose(file_out);
+        return false;
+    }
+
+    // append records after the last complete record:
+    long offset = sizeof(header) + header.n_records*sizeof(chessnet_record);
+    bool ok = (fseek(file_out, offset, SEEK_SET) == 0);
+
+    chessnet_record r;
+    for(unsigned int i = 0; ok && i < data.size(); ++i){
+        auto& [elem_board, elem_probs, elem_value] = data[i];
+        for(unsigned int k = 0; k < 64; ++k){ r.board[k] = static_cast<int8_t>(elem_board[k]); }
+        for(unsigned int k = 0; k < 64*64; ++k){
+            r.probs[k] = (isnan(elem_probs[k]))? 0.0f : static_cast<float>(elem_probs[k]);
+        }
+        r.value = static_cast<float>(elem_value);
+        ok = (fwrite(&r, sizeof(r), 1, file_out) == 1);
+    }
+
+    // commit the new records by updating the header:
+    if(ok){
+        fflush(file_out);
+        header.n_records += data.size();
+        ok = (fseek(file_out, 0, SEEK_SET) == 0) &&
+             (fwrite(&header, sizeof(header), 1, file_out) == 1);
+    }
+
+    if(!ok){
+        cerr << "Error: unable to write to \"" + path + "\"." << endl;
+    }
+
+    fclose(file_out);
+    return ok;
+}
+
+bool load_chessnet_dataset_file(chessnet_dataset& data, string path){
+
+    ChessNetDatasetFile file_in(path);
+    if(!file_in.is_open()){
+        return false;
+    }
+
+    size_t n = file_in.size();
+    data.reserve(data.size() + n);
+    for(size_t i = 0; i < n; ++i){
+        data.emplace_back();
+        auto& [elem_board, elem_probs, elem_value] = data.back();
+        file_in.get_item(i, elem_board, elem_probs, elem_value);
+    }
+
+    return true;
+}
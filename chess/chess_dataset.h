@@ -0,0 +1,116 @@
+#ifndef CHESS_DATASET_H
+#define CHESS_DATASET_H
+
+#include <array>
+#include <tuple>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "chess_game_state.h"
+#include "chess_augmentation.h"
+#include "util/mmap_file.h"
+
+using namespace std;
+
+typedef vector<tuple<array<piece,64>,array<double,64*64>,double>> chessnet_dataset;
+
+/**
+ * Dataset file format:
+ *
+ *   [ chessnet_file_header ][ chessnet_record 0 ][ chessnet_record 1 ] ...
+ *
+ *  Records are fixed-size, so record i starts at byte offset:
+ *
+ *      sizeof(chessnet_file_header) + i*sizeof(chessnet_record)
+ *
+ *  and the file can be mapped into memory and sampled without being loaded.
+ *  Records are only ever appended; the record count in the header is
+ *  updated after the records are written, so a partially written tail
+ *  (e.g. from an interrupted self-play run) is ignored and overwritten
+ *  by the next append. All values are stored in host (little-endian) byte order.
+ */
+
+const char CHESSNET_FILE_MAGIC[8] = { 'M','C','T','S','D','A','T','A' };
+const uint32_t CHESSNET_FILE_VERSION = 1;
+
+struct chessnet_file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t n_records;
+};
+
+struct chessnet_record {
+    int8_t board[64];
+    float value;
+    float probs[64*64];
+};
+
+/**
+ * Abstract source of training examples. Items are packed directly
+ * into the network input/output buffers:
+ *
+ *   x    : [8,8,6] board planes
+ *   y_pi : [64*64] move probabilities
+ *   y_v  : [1] game value
+ *
+ *  An item can be packed under a board symmetry (see chess_augmentation.h),
+ *  in which case each element is written directly at its remapped index
+ *  (the mirror is dropped if it is not valid for the item's board).
+ */
+class ChessNetDataSource {
+public:
+    virtual ~ChessNetDataSource(){}
+
+    virtual size_t size() = 0;
+
+    virtual void pack_item(size_t idx, float* x, float* y_pi, float* y_v,
+                           chessnet_symmetry s = SYM_IDENTITY) = 0;
+};
+
+class ChessNetMemoryDataSource : public ChessNetDataSource {
+private:
+    chessnet_dataset& data;
+
+public:
+    ChessNetMemoryDataSource(chessnet_dataset& data) : data(data) {}
+
+    size_t size(){ return data.size(); }
+
+    void pack_item(size_t idx, float* x, float* y_pi, float* y_v,
+                   chessnet_symmetry s = SYM_IDENTITY);
+};
+
+class ChessNetDatasetFile : public ChessNetDataSource {
+private:
+    string path;
+    util::mmap_file file;
+    const chessnet_record* records;
+    size_t n_records;
+
+public:
+    ChessNetDatasetFile(string path);
+
+    // re-map the file (to pick up records appended since it was opened):
+    bool reload();
+
+    bool is_open(){ return records != nullptr; }
+
+    size_t size(){ return n_records; }
+
+    const chessnet_record& get_record(size_t idx){ return records[idx]; }
+
+    void get_item(size_t idx, array<piece,64>& board, array<double,64*64>& probs, double& value);
+
+    void pack_item(size_t idx, float* x, float* y_pi, float* y_v,
+                   chessnet_symmetry s = SYM_IDENTITY);
+};
+
+void pack_chessnet_record(const chessnet_record& r, float* x, float* y_pi, float* y_v,
+                          chessnet_symmetry s = SYM_IDENTITY);
+
+bool append_chessnet_dataset_file(chessnet_dataset& data, string path);
+bool load_chessnet_dataset_file(chessnet_dataset& data, string path);
+
+#endif /* CHESS_DATASET_H */
@@ -0,0 +1,45 @@
+#ifndef CHESS_EVALUATOR_H
+#define CHESS_EVALUATOR_H
+
+#include <vector>
+#include <memory>
+
+#include "chess_game_logic.h"
+#include "chess_game_state.h"
+#include "chess_inference_stats.h"
+
+using namespace std;
+
+/**
+ * Position evaluator used by ChessNetMCTS to expand leaf nodes.
+ *
+ *  An evaluator estimates the value of a position (from white's
+ *  perspective, in [-1,1]) and a normalized prior probability for each of
+ *  the given (nonempty) valid actions. This interface does not depend on
+ *  TensorFlow, so searches can be run with evaluators that do not use a
+ *  network (see ChessHeuristicEvaluator).
+ */
+class ChessNetEvaluator {
+protected:
+    shared_ptr<ChessNetInferenceStats> stats;
+
+public:
+    ChessNetEvaluator() : stats(make_shared<ChessNetInferenceStats>()) {}
+
+    virtual ~ChessNetEvaluator(){}
+
+    virtual double evaluate(GameState& gs, color player_to_move,
+                            vector<move_vector>& actions, vector<double>& prob_estimates) = 0;
+
+    // called at the start of each search:
+    virtual void begin_search(){}
+
+    // version of the evaluated model (0 if unversioned):
+    virtual unsigned int get_model_version(){ return 0; }
+
+    // (stats may be shared between several evaluators)
+    shared_ptr<ChessNetInferenceStats> get_stats(){ return stats; }
+    void set_stats(shared_ptr<ChessNetInferenceStats> stats){ this->stats = stats; }
+};
+
+#endif /* CHESS_EVALUATOR_H */
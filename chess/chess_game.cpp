@@ -14,7 +14,9 @@
 #include <algorithm>
 
 #include "chess_game.h"
+#include "chess_batch_stream.h"
 #include "chessnet_config.h"
+#include "cppflow/ops.h"
 #include "util/string_ops.h"
 
 ChessPlayerAgent::ChessPlayerAgent(color agent_color, istream& player_input) : ChessAgent(agent_color), 
@@ -103,8 +105,9 @@ void ChessPlayerAgent::reset_agent(ostream& log, bool verbose){
 }
 
 
-ChessNetAgent::ChessNetAgent(color agent_color, string model_path, unsigned int sims_per_move) : ChessAgent(agent_color),
-    nnet_mcts(ChessNetMCTS(GameState(),model_path)) {
+ChessNetAgent::ChessNetAgent(color agent_color, string model_path, unsigned int sims_per_move,
+                             const chessnet_session_config& session_config) : ChessAgent(agent_color),
+    nnet_mcts(ChessNetMCTS(GameState(),make_shared<ChessNetModelEvaluator>(model_path,session_config))) {
     this->game_boards = vector<array<piece,64>>();
     this->game_probs = vector<array<double,64*64>>();
     this->game_moves = vector<move_vector>();
@@ -116,7 +119,19 @@ ChessNetAgent::ChessNetAgent(color agent_color, string model_path, unsigned int
 }
 
 ChessNetAgent::ChessNetAgent(color agent_color, cppflow::model& model, unsigned int sims_per_move) : ChessAgent(agent_color),
-    nnet_mcts(ChessNetMCTS(GameState(),model)) {
+    nnet_mcts(ChessNetMCTS(GameState(),make_shared<ChessNetModelEvaluator>(model))) {
+    this->game_boards = vector<array<piece,64>>();
+    this->game_probs = vector<array<double,64*64>>();
+    this->game_moves = vector<move_vector>();
+    this->game_value = 0.0;
+    this->sims_per_move = sims_per_move;
+
+    this->rng_engine.seed(std::chrono::system_clock::now().time_since_epoch().count());
+    this->random_prob = uniform_real_distribution<double>(0.0,1.0);
+}
+
+ChessNetAgent::ChessNetAgent(color agent_color, shared_ptr<ChessNetModelSlot> model_slot, unsigned int sims_per_move) : ChessAgent(agent_color),
+    nnet_mcts(ChessNetMCTS(GameState(),make_shared<ChessNetModelEvaluator>(model_slot))) {
     this->game_boards = vector<array<piece,64>>();
     this->game_probs = vector<array<double,64*64>>();
     this->game_moves = vector<move_vector>();
@@ -330,41 +345,81 @@ void print_info(chessnet_dataset& data, ostream& os){
 ChessNetSelfPlay::ChessNetSelfPlay(string model_path, 
                         unsigned int batch_size, 
                         unsigned int sims_per_move, 
-                        double validation_holdout) : 
-                        old_model(model_path), new_model(model_path){
+                        double validation_holdout,
+                        const chessnet_session_config& serve_config,
+                        const chessnet_session_config& train_config) : 
+                        serve_config(serve_config), train_config(train_config),
+                        model_slot(make_shared<ChessNetModelSlot>(
+                            get_chessnet_model_registry().get(model_path, serve_config))), 
+                        new_model(load_chessnet_model(model_path, train_config)){
 
     this->model_path = model_path;
     this->batch_size = batch_size;
     this->sims_per_move = sims_per_move;
     this->validation_holdout = validation_holdout;
-
-    this->new_model = cppflow::model(model_path);
-    this->old_model = cppflow::model(model_path);
+    this->augmentation = AUGMENT_NONE;
 }
 
 double ChessNetSelfPlay::do_self_play_episode(unsigned int n_games, 
             chessnet_dataset& training_data, ostream& log, bool verbose){
 
+    double new_win_rate = play_self_play_games(n_games, 
+        [&training_data](chessnet_dataset& game_data){
+            training_data.insert(training_data.end(), game_data.begin(), game_data.end());
+        }, log, verbose);
+
+    if(verbose){
+        log << "# of training examples: " << training_data.size() << endl;
+    }
+
+    return new_win_rate;
+}
+
+double ChessNetSelfPlay::do_self_play_episode(unsigned int n_games, 
+            ChessNetReplayBuffer& replay_buffer, ostream& log, bool verbose){
+
+    double new_win_rate = play_self_play_games(n_games, 
+        [&replay_buffer](chessnet_dataset& game_data){
+            replay_buffer.add(game_data);
+        }, log, verbose);
+
+    if(verbose){
+        log << "# of replay buffer positions: " << replay_buffer.size() 
+            << " (" << replay_buffer.get_n_ingested() << " ingested)" << endl;
+    }
+
+    return new_win_rate;
+}
+
+double ChessNetSelfPlay::play_self_play_games(unsigned int n_games, 
+            const function<void(chessnet_dataset&)>& add_game_data, 
+            ostream& log, bool verbose){
+
     unsigned int new_wins = 0;
     bool new_playing_as_white = false;
 
     // randomly assign black/white players:
     shared_ptr<ChessNetAgent> b, w;
     if(rand() & 1){
-        w = make_shared<ChessNetAgent>(WHITE, old_model);
+        w = make_shared<ChessNetAgent>(WHITE, model_slot);
         b = make_shared<ChessNetAgent>(BLACK, new_model);
     } else {
         w = make_shared<ChessNetAgent>(WHITE, new_model);
-        b = make_shared<ChessNetAgent>(BLACK, old_model);
+        b = make_shared<ChessNetAgent>(BLACK, model_slot);
         new_playing_as_white = true;
     }
 
+    chessnet_dataset game_data;
     for(unsigned int n = 0; n < n_games; ++n){
 
         // play a game:
         ChessGame game = ChessGame(w,b,log,verbose);
         game.play();
-        w->get_training_data(training_data);
+
+        // hand the game data over as soon as the game is finished:
+        game_data.clear();
+        w->get_training_data(game_data);
+        add_game_data(game_data);
 
         // record number of wins by new network:
         if((w->get_game_value() > 0.0) && new_playing_as_white){
@@ -379,10 +434,6 @@ double ChessNetSelfPlay::do_self_play_episode(unsigned int n_games,
 
     w->clear_agent_cache(log, verbose);
     b->clear_agent_cache(log, verbose);
-
-    if(verbose){
-        log << "# of training examples: " << training_data.size() << endl;
-    }
     
     return static_cast<double>(new_wins) / static_cast<double>(n_games);
 }
@@ -392,8 +443,16 @@ double ChessNetSelfPlay::do_training_steps(unsigned int n_epochs,
             unsigned int seed, 
             ostream& log, 
             bool verbose, bool reset_optimizer){
-    
-    double final_loss = 0.0;
+
+    ChessNetMemoryDataSource data_source(training_data);
+    return do_training_steps(n_epochs, data_source, seed, log, verbose, reset_optimizer);
+}
+
+double ChessNetSelfPlay::do_training_steps(unsigned int n_epochs, 
+            ChessNetDataSource& training_data, 
+            unsigned int seed, 
+            ostream& log, 
+            bool verbose, bool reset_optimizer){
 
     // reset optimizer (optional):
     if(reset_optimizer){
@@ -409,77 +468,61 @@ double ChessNetSelfPlay::do_training_steps(unsigned int n_epochs,
     }
     shuffle(data_idxs.begin(), data_idxs.end(), default_random_engine(seed));
     
-    // initialize train/validation tensors:
-    vector<cppflow::tensor> x_train_batches, 
-                            y_pi_train_batches,
-                            y_v_train_batches,
-                            x_test_batches,
-                            y_pi_test_batches,
-                            y_v_test_batches;
-
+    // split batches into train/validation indices:
     unsigned int split_idx = static_cast<unsigned int>(
         data_idxs.size()*validation_holdout
     );
-
-    // pack data into train/validation tensors:
+    unsigned int n_batches = 0, n_test_batches = 0;
     for(unsigned int i = 0; i + batch_size < data_idxs.size(); i += batch_size){
+        if(i < split_idx){ ++n_test_batches; }
+        ++n_batches;
+    }
 
-        // pack tensors in batches:
-        auto batch_x = vector<float>(batch_size*8*8*6, 0.0f); 
-        auto batch_y_pi = vector<float>(batch_size*64*64);
-        auto batch_y_v = vector<float>(batch_size);
-
-        for(unsigned int j = 0; j < batch_size; ++j){
-            assert(i+j < data_idxs.size());
-            unsigned int data_idx = data_idxs[i+j];
+    auto test_idxs = vector<unsigned int>(data_idxs.begin(), 
+                                          data_idxs.begin() + n_test_batches*batch_size);
+    auto train_idxs = vector<unsigned int>(data_idxs.begin() + n_test_batches*batch_size, 
+                                           data_idxs.begin() + n_batches*batch_size);
+    
+    return train_on_batches(training_data, train_idxs, test_idxs, n_epochs, seed, log, verbose);
+}
 
-            // retrieve data element tuple: (board, pi_probs, value)
-            auto [elem_board, elem_probs, elem_value] = training_data[data_idx];
-            
-            // pack x tensor: [batch size,8,8,6]
-            for(unsigned int k = 0; k < 64; ++k){
-                piece p = elem_board[k];
-                if(p){
-                    int p_idx = (p>>1)-1;
-                    assert(0 <= p_idx && p_idx < 6);
-                    batch_x[(j*8*8*6) + k*6+p_idx] = ((is_white(p))? 1.0f : -1.0f);
-                }
-            }
+double ChessNetSelfPlay::do_replay_training_steps(unsigned int n_steps, 
+            ChessNetReplayBuffer& replay_buffer, 
+            unsigned int seed, 
+            ostream& log, 
+            bool verbose, double recency_half_life){
+
+    // sample minibatch positions from the replay buffer:
+    //    (positions are sampled with replacement, so validation batches
+    //     are not held out from training)
+    auto rng = default_random_engine(seed);
+    auto train_idxs = vector<unsigned int>();
+    auto test_idxs = vector<unsigned int>();
+    unsigned int n_test_steps = static_cast<unsigned int>(n_steps*validation_holdout);
+
+    if(recency_half_life > 0.0){
+        replay_buffer.sample_recent(n_steps*batch_size, recency_half_life, rng, train_idxs);
+        replay_buffer.sample_recent(n_test_steps*batch_size, recency_half_life, rng, test_idxs);
+    } else {
+        replay_buffer.sample_uniform(n_steps*batch_size, rng, train_idxs);
+        replay_buffer.sample_uniform(n_test_steps*batch_size, rng, test_idxs);
+    }
 
-            // pack y_pi tensor: [batch size, 64*64]
-            for(unsigned int k = 0; k < 64*64; ++k){
-                if(isnan(elem_probs[k])){
-                    batch_y_pi[(j*64*64) + k] = 0.0;
-                } else {
-                    batch_y_pi[(j*64*64) + k] = elem_probs[k];
-                }
-            }
+    return train_on_batches(replay_buffer, train_idxs, test_idxs, 1, seed, log, verbose);
+}
 
-            // pack y_v tensor: [batch size]
-            batch_y_v[j]= elem_value;
-        }
+double ChessNetSelfPlay::train_on_batches(ChessNetDataSource& training_data, 
+            vector<unsigned int>& train_idxs, 
+            vector<unsigned int>& test_idxs,
+            unsigned int n_epochs, unsigned int seed, 
+            ostream& log, bool verbose){
 
-        // cast cpp vectors to tensors:
-        auto batch_x_tensor = cppflow::tensor(batch_x, {batch_size, 8,8,6});
-        auto batch_y_pi_tensor = cppflow::tensor(batch_y_pi, {batch_size, 64*64});
-        auto batch_y_v_tensor = cppflow::tensor(batch_y_v, {batch_size});
+    double final_loss = 0.0;
+    unsigned int n_train_batches = train_idxs.size() / batch_size;
+    unsigned int n_test_batches = test_idxs.size() / batch_size;
 
-        // add tensors to dataset (train or test):        
-        if(i < split_idx){
-            x_test_batches.push_back(batch_x_tensor);
-            y_pi_test_batches.push_back(batch_y_pi_tensor);
-            y_v_test_batches.push_back(batch_y_v_tensor);
-        } else {
-            x_train_batches.push_back(batch_x_tensor);
-            y_pi_train_batches.push_back(batch_y_pi_tensor);
-            y_v_train_batches.push_back(batch_y_v_tensor);
-        }
-    }
-    
-    
     // perform training loop:
-    unsigned int n_train_batches = x_train_batches.size();
-    unsigned int n_test_batches = x_test_batches.size();
+    chessnet_batch batch;
     for(unsigned int n = 0; n < n_epochs; ++n){
 
         if(verbose){
@@ -493,12 +536,13 @@ double ChessNetSelfPlay::do_training_steps(unsigned int n_epochs,
             << endl;
         }
 
-        // perform epoch on training data:
+        // perform epoch on training data (batches are packed and augmented in the background):
         double mean_v_loss = 0.0, mean_pi_loss = 0.0, mean_total_loss = 0.0;
-        for(unsigned int i = 0; i < n_train_batches; ++i){
-            auto batch_loss = new_model({{TRAIN_X_INPUT, x_train_batches[i]},
-                                    {TRAIN_Y_PI_INPUT, y_pi_train_batches[i]},
-                                    {TRAIN_Y_V_INPUT, y_v_train_batches[i]}},
+        ChessNetBatchStream train_stream(training_data, train_idxs, batch_size, augmentation, seed + n);
+        while(train_stream.next(batch)){
+            auto batch_loss = new_model({{TRAIN_X_INPUT, batch.x},
+                                    {TRAIN_Y_PI_INPUT, batch.y_pi},
+                                    {TRAIN_Y_V_INPUT, batch.y_v}},
                                     {TRAIN_V_LOSS_OUTPUT,
                                      TRAIN_PI_LOSS_OUTPUT,
                                      TRAIN_TOTAL_LOSS_OUTPUT});
@@ -510,9 +554,12 @@ double ChessNetSelfPlay::do_training_steps(unsigned int n_epochs,
             mean_pi_loss += pi_loss_vec[0];
             mean_total_loss += total_loss_vec[0];
         }
-        mean_v_loss /= n_train_batches;
-        mean_pi_loss /= n_train_batches;
-        mean_total_loss /= n_train_batches;
+        if(n_train_batches > 0){
+            mean_v_loss /= n_train_batches;
+            mean_pi_loss /= n_train_batches;
+            mean_total_loss /= n_train_batches;
+        }
+        final_loss = mean_total_loss;
         
         // print training loss:
         if(verbose){
@@ -523,14 +570,18 @@ double ChessNetSelfPlay::do_training_steps(unsigned int n_epochs,
              << endl;
         }
 
-        // perform validation epoch:
+        // perform validation epoch (if there is validation data):
+        if(n_test_batches == 0){
+            continue;
+        }
         mean_v_loss = 0.0; 
         mean_pi_loss = 0.0; 
         mean_total_loss = 0.0;
-        for(unsigned int i = 0; i < n_test_batches; ++i){
-            auto batch_loss = new_model({{VALIDATE_X_INPUT, x_test_batches[i]},
-                                    {VALIDATE_Y_PI_INPUT, y_pi_test_batches[i]},
-                                    {VALIDATE_Y_V_INPUT, y_v_test_batches[i]}},
+        ChessNetBatchStream test_stream(training_data, test_idxs, batch_size);
+        while(test_stream.next(batch)){
+            auto batch_loss = new_model({{VALIDATE_X_INPUT, batch.x},
+                                    {VALIDATE_Y_PI_INPUT, batch.y_pi},
+                                    {VALIDATE_Y_V_INPUT, batch.y_v}},
                                     {VALIDATE_V_LOSS_OUTPUT,
                                      VALIDATE_PI_LOSS_OUTPUT,
                                      VALIDATE_TOTAL_LOSS_OUTPUT});
@@ -564,15 +615,16 @@ double ChessNetSelfPlay::do_training_steps(unsigned int n_epochs,
 
 void ChessNetSelfPlay::save_model(){
     // export weights to override existing weights:
-    string variables_path = util::strip(model_path);
-    if(variables_path[-1] != '/'){ variables_path += "/"; }
-    variables_path += MODEL_VARIABLES_DIR + "/" + MODEL_VARIABLES_NAME;
-
-    auto path_in = cppflow::tensor(std::string(variables_path));
+    auto path_in = cppflow::tensor(get_model_variables_path(model_path));
     new_model({{SAVE_MODEL_PATH_INPUT, path_in}},{SAVE_MODEL_PATH_OUTPUT});
 
-    // re-load saved the old model as the recently saved model
-    this->old_model = cppflow::model(model_path);
+    // publish the saved weights as a new model version (searches that are
+    // still running keep the previous version until they finish). The
+    // registry's handles to the previous version are dropped first, so
+    // agents created from the model path load the same new version:
+    auto& registry = get_chessnet_model_registry();
+    registry.release(model_path);
+    model_slot->publish(registry.get(model_path, serve_config));
 }
 
 void ChessNetSelfPlay::export_model(string path){
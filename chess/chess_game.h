@@ -4,10 +4,14 @@
 #include <chrono>
 #include <random>
 #include <tuple>
+#include <functional>
 
 #include "chess_mcts.h"
+#include "chess_model_evaluator.h"
 #include "chess_game_logic.h"
 #include "chess_game_state.h"
+#include "chess_dataset.h"
+#include "chess_replay_buffer.h"
 
 class ChessAgent {
 protected:
@@ -46,8 +50,6 @@ public:
 
 };
 
-typedef vector<tuple<array<piece,64>,array<double,64*64>,double>> chessnet_dataset;
-
 bool load_chessnet_dataset(chessnet_dataset& data, string path);
 bool save_chessnet_dataset(chessnet_dataset& data, string path);
 void print_info(chessnet_dataset& data, ostream& out);
@@ -65,8 +67,10 @@ private:
     double game_value;
 
 public:
-    ChessNetAgent(color agent_color, string model_path, unsigned int sims_per_move=256);
+    ChessNetAgent(color agent_color, string model_path, unsigned int sims_per_move=256,
+                  const chessnet_session_config& session_config = chessnet_session_config());
     ChessNetAgent(color agent_color, cppflow::model& model, unsigned int sims_per_move=256);
+    ChessNetAgent(color agent_color, shared_ptr<ChessNetModelSlot> model_slot, unsigned int sims_per_move=256);
 
     bool prompt_next_move(move_vector& move, ostream& log, bool verbose = false);
 
@@ -108,26 +112,58 @@ protected:
     unsigned int batch_size;
     unsigned int sims_per_move;
     double validation_holdout;
+    unsigned int augmentation;                  // (of training batches, off by default, see chess_augmentation.h)
+
+    chessnet_session_config serve_config;
+    chessnet_session_config train_config;
+
+    shared_ptr<ChessNetModelSlot> model_slot;   // (latest saved model)
+    cppflow::model new_model;                   // (private to the trainer)
 
-    cppflow::model old_model;
-    cppflow::model new_model;
+    double play_self_play_games(unsigned int n_games, 
+                const function<void(chessnet_dataset&)>& add_game_data, 
+                ostream& log, bool verbose);
+
+    double train_on_batches(ChessNetDataSource& training_data, 
+                vector<unsigned int>& train_idxs, 
+                vector<unsigned int>& test_idxs,
+                unsigned int n_epochs, unsigned int seed, 
+                ostream& log, bool verbose);
 
 public:
 
     ChessNetSelfPlay(string model_path, 
                         unsigned int batch_size = 4, 
                         unsigned int sims_per_move = 256, 
-                        double validation_holdout = 0.1);
+                        double validation_holdout = 0.1,
+                        const chessnet_session_config& serve_config = chessnet_session_config(),
+                        const chessnet_session_config& train_config = chessnet_session_config());
     
     double do_self_play_episode(unsigned int n_games, 
                 chessnet_dataset& training_data, ostream& log, bool verbose = false);
 
+    double do_self_play_episode(unsigned int n_games, 
+                ChessNetReplayBuffer& replay_buffer, ostream& log, bool verbose = false);
+
     double do_training_steps(unsigned int n_epochs, 
                 chessnet_dataset& training_data, unsigned int seed, ostream& log, 
                 bool verbose = false, bool reset_optimizer = false);
 
+    double do_training_steps(unsigned int n_epochs, 
+                ChessNetDataSource& training_data, unsigned int seed, ostream& log, 
+                bool verbose = false, bool reset_optimizer = false);
+
+    double do_replay_training_steps(unsigned int n_steps, 
+                ChessNetReplayBuffer& replay_buffer, unsigned int seed, ostream& log, 
+                bool verbose = false, double recency_half_life = 0.0);
+
     void save_model();
 
+    shared_ptr<ChessNetModelSlot> get_model_slot(){ return model_slot; }
+
+    void set_augmentation(unsigned int augmentation){ this->augmentation = augmentation; }
+    unsigned int get_augmentation(){ return augmentation; }
+
     void export_model(string path);
 
 };
@@ -6,6 +6,7 @@
 
 #include "util/string_ops.h"
 #include "chess/chess_game_logic.h"
+#include "chess/chess_move_generator.h"
 
 using namespace std;
 
@@ -19,13 +20,9 @@ string to_move_vector_string(move_vector& m){
     stringstream ss;
     ss << "src position: (" << src_x(m) << ", " << src_y(m) << ")" << endl;
     ss << "dest position: (" << dest_x(m) << ", " << dest_y(m) << ")" << endl;
-    ss << "captured piece: " << to_display_char(captured_piece(m)) << endl;
     ss << "castling [left: " << is_lcastle(m) << ", right: " << is_rcastle(m) << "]" << endl;
     ss << "en passant: " << is_en_passant(m) << endl;
     ss << "promoted piece: " << to_display_char(promoted_piece(m)) << endl;
-    ss << "prev en passant: " << prev_en_passant(m) << " (at x = " << prev_en_passant_x(m) << ")" << endl;
-    ss << "prev castle: [left: " << prev_lcastle(m) << ", right: " << prev_rcastle(m) << "]" << endl;
-    ss << "prev check: " << prev_check(m) << endl;
 
     return ss.str();
 }
@@ -38,13 +35,11 @@ string to_movestring(GameState gs, move_vector m, bool shorthand){
     y0 = src_y(m);
     x1 = dest_x(m);
     y1 = dest_y(m);
-    cap_p = captured_piece(m);
+    cap_p = captured_piece(gs, m);
     
     // perform a move sanity check:
     piece src_p = gs.get_piece(x0,y0);
-    piece dest_p = gs.get_piece(x1,y1);
     assert( src_p );
-    assert( !cap_p || is_en_passant(m) || cap_p == dest_p );
 
     // compute final state and check/mate status:
     GameState move_gs = gs;
@@ -83,20 +78,24 @@ string to_movestring(GameState gs, move_vector m, bool shorthand){
     return ss.str();
 }
 
-bool parse_text_move(move_vector& m, GameState& gs, color player_to_move, string str){
+static bool resolve_san_move(move_vector& m, GameState& gs, color player, piece src_p, piece prom_p,
+                             bool capture, int v_src_x, int v_src_y, int x1, int y1);
+
+bool parse_text_move(move_vector& m, GameState& gs, color player_to_move, string_view str){
 
     const string PIECES = "PRNBQK";
-    auto valid_moves = get_valid_moves(gs, player_to_move);
+    StagedMoveGenerator gen(gs, player_to_move);
+    move_vector v;
 
-    string ss = util::strip(str);
-    ss = util::strip(ss," +#!?");
+    string_view ss = util::strip_view(str);
+    ss = util::strip_view(ss," +#!?");
 
 
     if(ss.size() == 0){ return false; }
 
     if(ss == "rcastle" || ss == "OO" || ss == "O-O" || ss == "00" || ss == "0-0"){
         // handle right castling:
-        for(move_vector v : valid_moves){
+        while(gen.next(v)){
             if(is_rcastle(v)){
                 m = v;
                 return true;
@@ -108,7 +107,7 @@ bool parse_text_move(move_vector& m, GameState& gs, color player_to_move, string
     if(ss == "lcastle" || ss == "OOO" || ss == "O-O-O" 
                 || ss == "000" || ss == "0-0-0"){
         // handle left castling:
-        for(move_vector v : valid_moves){
+        while(gen.next(v)){
             if(is_lcastle(v)){
                 m = v;
                 return true;
@@ -124,7 +123,7 @@ bool parse_text_move(move_vector& m, GameState& gs, color player_to_move, string
     
     // check if string is of the form "xx xx"
     // (using rank-file notation)
-    if(ss.find(" ") != string::npos){
+    if(ss.find(" ") != string_view::npos){
         if(ss.size() != 5){ return false; }
         v_src_x = (ss[0]-'a');
         v_src_y = (ss[1]-'1');
@@ -138,7 +137,7 @@ bool parse_text_move(move_vector& m, GameState& gs, color player_to_move, string
             return false;
         }
 
-        for(move_vector v : valid_moves){
+        while(gen.next(v)){
             if(v_src_x == src_x(v) && v_src_y == src_y(v) 
             && v_dest_x == dest_x(v) && v_dest_y == dest_y(v)){
                 m = v;
@@ -166,47 +165,199 @@ bool parse_text_move(move_vector& m, GameState& gs, color player_to_move, string
             }
         }
 
-        vector<move_vector> matched_mvs;
-        /*
-        cout << gs << endl;
-        cout << ss << endl;
-        cout << v_src_x << " " << v_src_y << endl;
-        cout << v_dest_x << " " << v_dest_y << endl;
-        cout << capture << " " << src_p
-             << " " << get_color(src_p) << endl;
-        */
-        
-        for(move_vector v : valid_moves){
-            /*
-            cout << to_movestring(gs, v) << endl;
-            cout << (v_src_x < 0  || v_src_x == src_x(v))
-                << (v_src_y < 0  || v_src_y == src_y(v))    
-                << (v_dest_x < 0 || v_dest_x == dest_x(v)) 
-                << (v_dest_y < 0 || v_dest_y == dest_y(v))
-                << ((captured_piece(v) != NONE) == capture)
-                << (src_p == gs.get_piece(src_x(v),src_y(v))) 
-                << (prom_p == promoted_piece(v)) << endl; 
-            */
-            
-            if((v_src_x < 0  || v_src_x == src_x(v))    &&
-               (v_src_y < 0  || v_src_y == src_y(v))    &&
-               (v_dest_x < 0 || v_dest_x == dest_x(v))  &&
-               (v_dest_y < 0 || v_dest_y == dest_y(v))  &&
-               ((captured_piece(v) != NONE) == capture)     &&
-               (src_p == gs.get_piece(src_x(v),src_y(v)))   &&
-               (prom_p == promoted_piece(v))
-               ){
-                // add match to list:    
-                matched_mvs.push_back(v);
+        return resolve_san_move(m, gs, player_to_move, src_p, prom_p, capture, 
+                                v_src_x, v_src_y, v_dest_x, v_dest_y);
+    }
+    return false;
+}
+
+// ray directions (0-3: rectilinear, 4-7: diagonal):
+const int RAY_DX[8] = { 1, 0, -1,  0, 1, -1, -1,  1 };
+const int RAY_DY[8] = { 0, 1,  0, -1, 1,  1, -1, -1 };
+
+// precomputed ray lookups between squares (k = 8*y + x):
+struct ray_tables {
+    int8_t dir[64][64];         // (direction from a to b, or -1 if not aligned)
+    uint8_t length[64][8];      // (# of squares from a to the board edge)
+
+    constexpr ray_tables() : dir(), length() {
+        for(int a = 0; a < 64; ++a){
+            for(int b = 0; b < 64; ++b){ dir[a][b] = -1; }
+            for(int d = 0; d < 8; ++d){
+                int x = (a&7) + RAY_DX[d], y = (a>>3) + RAY_DY[d];
+                while(0 <= x && x < 8 && 0 <= y && y < 8){
+                    dir[a][(y<<3) | x] = d;
+                    ++length[a][d];
+                    x += RAY_DX[d];
+                    y += RAY_DY[d];
+                }
             }
         }
+    }
+};
 
-        if(matched_mvs.size() == 1){
-            m = matched_mvs[0];
-            return true;
+static constexpr ray_tables RAYS;
+
+inline int ray_step(int d){ return RAY_DY[d]*8 + RAY_DX[d]; }
+
+inline bool slides_along(piece p, int d){
+    return is_queen(p) || ((d < 4)? is_rook(p) : is_bishop(p));
+}
+
+// returns the first piece along direction d from square a (or NONE):
+inline piece first_piece_on_ray(const GameState& gs, int a, int d){
+    int step = ray_step(d);
+    for(int n = RAYS.length[a][d], k = a + step; n > 0; --n, k += step){
+        if(gs.board[k]){ return gs.board[k]; }
+    }
+    return NONE;
+}
+
+// true if piece p on square a attacks square b:
+static bool piece_attacks(const GameState& gs, piece p, int a, int b){
+    int dx = (b&7) - (a&7), dy = (b>>3) - (a>>3);
+    if(is_pawn(p)){
+        return abs(dx) == 1 && dy == (is_white(p)? 1 : -1);
+    } else if(is_knight(p)){
+        return (abs(dx) == 1 && abs(dy) == 2) || (abs(dx) == 2 && abs(dy) == 1);
+    } else if(is_king(p)){
+        return abs(dx) <= 1 && abs(dy) <= 1;
+    }
+
+    int d = RAYS.dir[a][b];
+    if(d < 0 || !slides_along(p, d)){ return false; }
+    int step = ray_step(d);
+    for(int k = a + step; k != b; k += step){
+        if(gs.board[k]){ return false; }
+    }
+    return true;
+}
+
+// true if emptying square a exposes square b to a slider of the attacker:
+static bool discovers_attack(const GameState& gs, int a, int b, color attacker){
+    int d = RAYS.dir[b][a];
+    if(d < 0){ return false; }
+    piece p = first_piece_on_ray(gs, b, d);
+    return p && get_color(p) == attacker && slides_along(p, d);
+}
+
+/*
+ * Resolves a SAN move to the unique valid move of piece src_p to square (x1,y1) 
+ * that matches the (optional) origin file/rank, capture and promotion. The origin
+ * squares are found by looking back from the destination along the moves of the
+ * piece (reverse attacks), so only these few candidates are checked for legality.
+ */
+static bool resolve_san_move(move_vector& m, GameState& gs, color player, piece src_p, piece prom_p,
+                             bool capture, int v_src_x, int v_src_y, int x1, int y1){
+
+    const int KNIGHT_DX[8] = { 2, 1, -1, -2, -2, -1,  1,  2 };
+    const int KNIGHT_DY[8] = { 1, 2,  2,  1, -1, -2, -2, -1 };
+
+    if(!(0 <= x1 && x1 < 8 && 0 <= y1 && y1 < 8)){ return false; }
+
+    int dest = (y1<<3) | x1;
+    piece dest_p = gs.board[dest];
+    if(dest_p && (get_color(dest_p) == player || is_king(dest_p) || !capture)){ return false; }
+    if(!dest_p && capture && !is_pawn(src_p)){ return false; }
+
+    // only pawns reaching the last rank are (and must be) promoted:
+    bool last_rank = (y1 == ((player == WHITE)? 7 : 0));
+    if(prom_p && (!is_pawn(src_p) || !last_rank || is_pawn(prom_p) || is_king(prom_p))){ return false; }
+    if(is_pawn(src_p) && last_rank && !prom_p){ return false; }
+
+    // find the origin squares of the player's src_p pieces that reach the destination:
+    int candidates[16];
+    int n_candidates = 0;
+    bool en_passant = false;
+
+    if(is_pawn(src_p)){
+        int dy = (player == WHITE)? 1 : -1;
+        int y0 = y1 - dy;
+        if(y0 < 1 || y0 > 6){ return false; }
+
+        if(capture){
+            if(!dest_p){
+                // (a capture onto an empty square must be en passant)
+                en_passant = (player == WHITE)?
+                    (y1 == 5 && b_en_passant(gs.state) && b_en_passant_x(gs.state) == x1) :
+                    (y1 == 2 && w_en_passant(gs.state) && w_en_passant_x(gs.state) == x1);
+                if(!en_passant){ return false; }
+            }
+            for(int x0 = x1-1; x0 <= x1+1; x0 += 2){
+                if(0 <= x0 && x0 < 8 && gs.get_piece(x0,y0) == src_p){
+                    candidates[n_candidates++] = (y0<<3) | x0;
+                }
+            }
+        } else if(!dest_p){
+            if(gs.get_piece(x1,y0) == src_p){
+                candidates[n_candidates++] = (y0<<3) | x1;
+            } else if(!gs.get_piece(x1,y0) && y1 == ((player == WHITE)? 3 : 4) 
+                      && gs.get_piece(x1,y0-dy) == src_p){
+                candidates[n_candidates++] = ((y0-dy)<<3) | x1;
+            }
+        }
+
+    } else if(is_knight(src_p)){
+        for(int i = 0; i < 8; ++i){
+            int x0 = x1 + KNIGHT_DX[i], y0 = y1 + KNIGHT_DY[i];
+            if(0 <= x0 && x0 < 8 && 0 <= y0 && y0 < 8 && gs.get_piece(x0,y0) == src_p){
+                candidates[n_candidates++] = (y0<<3) | x0;
+            }
+        }
+
+    } else if(is_king(src_p)){
+        int k0 = (player == WHITE)?
+            ((w_king_y(gs.king_pos)<<3) | w_king_x(gs.king_pos)) :
+            ((b_king_y(gs.king_pos)<<3) | b_king_x(gs.king_pos));
+        if(piece_attacks(gs, src_p, k0, dest)){ candidates[n_candidates++] = k0; }
+
+    } else {
+        // (the first piece along each ray from the destination)
+        for(int d = 0; d < 8; ++d){
+            if(!slides_along(src_p, d)){ continue; }
+            int step = ray_step(d);
+            for(int n = RAYS.length[dest][d], k = dest + step; n > 0; --n, k += step){
+                if(gs.board[k]){
+                    if(gs.board[k] == src_p){ candidates[n_candidates++] = k; }
+                    break;
+                }
+            }
         }
     }
-    return false;
+
+    // check the legality of the candidates matching the origin file/rank:
+    int n_matched = 0;
+    for(int i = 0; i < n_candidates; ++i){
+        int x0 = candidates[i] & 7, y0 = candidates[i] >> 3;
+        if((v_src_x >= 0 && v_src_x != x0) || (v_src_y >= 0 && v_src_y != y0)){ continue; }
+
+        move_vector v = 0;
+        set_src_pos(v, x0, y0);
+        set_dest_pos(v, x1, y1);
+        if(prom_p){ set_promoted_piece(v, prom_p); }
+        if(en_passant){ set_en_passant(v); }
+
+        if(!move_will_check_king(gs, v, player)){
+            m = v;
+            ++n_matched;
+        }
+    }
+
+    return (n_matched == 1);
+}
+
+/*
+ * Determines if the (applied) move checks the opponent's king: either the moved
+ * piece attacks the king, or a vacated square uncovers an attack by a slider.
+ */
+static bool move_gives_check(const GameState& gs, piece moved_p, int moved_sq, 
+                             int vacated_sq, int vacated_sq2, int king_sq, color attacker){
+    bool check = piece_attacks(gs, moved_p, moved_sq, king_sq) ||
+                 discovers_attack(gs, vacated_sq, king_sq, attacker) ||
+                 (vacated_sq2 >= 0 && discovers_attack(gs, vacated_sq2, king_sq, attacker));
+
+    assert(check == is_checked(const_cast<GameState&>(gs), king_sq & 7, king_sq >> 3, attacker));
+    return check;
 }
 
 void apply_move(GameState& gs, move_vector m){
@@ -218,12 +369,18 @@ void apply_move(GameState& gs, move_vector m){
     
     piece src_p = gs.get_piece(x0,y0);
     piece dest_p = gs.get_piece(x1,y1);
-    piece cap_p  = captured_piece(m);
+    piece cap_p  = captured_piece(gs, m);
     piece prom_p = promoted_piece(m);
     color src_color = get_color(src_p);
     color oth_color = !src_color;
     assert( src_p );
 
+    // (the piece that can give check, and the squares that are vacated)
+    piece moved_p = (prom_p)? prom_p : src_p;
+    int moved_sq = (y1<<3) | x1;
+    int vacated_sq = (y0<<3) | x0;
+    int vacated_sq2 = -1;
+
     if(prom_p){
             // perform pawn promotion:
             assert(get_color(prom_p) == src_color);
@@ -247,11 +404,13 @@ void apply_move(GameState& gs, move_vector m){
                 assert(w_en_passant_x(gs.state) == x1);
                 assert(gs.get_piece(x1,y1+1) == cap_p);
                 gs.set_piece(x1,y1+1,NONE);
+                vacated_sq2 = ((y1+1)<<3) | x1;
             } else {
                 assert(gs.get_piece(x1,y1-1) == cap_p);
                 assert(b_en_passant(gs.state));
                 assert(b_en_passant_x(gs.state) == x1);
                 gs.set_piece(x1, y1-1, NONE);
+                vacated_sq2 = ((y1-1)<<3) | x1;
             }
 
         } else {
@@ -283,6 +442,9 @@ void apply_move(GameState& gs, move_vector m){
         gs.set_piece(4,csl_y,NONE);
         gs.set_piece(7,csl_y,NONE);
         x1 = 6; // <-- set x2 to account for king movement
+        moved_p = dest_p;
+        moved_sq = (csl_y<<3) | 5;
+        vacated_sq2 = (csl_y<<3) | 7;
 
         if(src_color == WHITE){
             gs.set_piece(5,csl_y,W_ROOK);
@@ -315,6 +477,9 @@ void apply_move(GameState& gs, move_vector m){
         gs.set_piece(4,csl_y,NONE);
         gs.set_piece(0,csl_y,NONE);
         x1 = 2; // <-- set x2 to account for king movement
+        moved_p = dest_p;
+        moved_sq = (csl_y<<3) | 3;
+        vacated_sq2 = (csl_y<<3) | 0;
 
         if(src_color == WHITE){
             gs.set_piece(3,csl_y,W_ROOK);
@@ -367,7 +532,8 @@ void apply_move(GameState& gs, move_vector m){
         clear_w_check(gs.state);
 
         // set check status for opposing black king:
-        if(is_checked(gs,b_king_x(gs.king_pos),b_king_y(gs.king_pos),WHITE)){
+        if(move_gives_check(gs, moved_p, moved_sq, vacated_sq, vacated_sq2, 
+                            (b_king_y(gs.king_pos)<<3) | b_king_x(gs.king_pos), WHITE)){
             set_b_check(gs.state);
         }
 
@@ -408,13 +574,22 @@ void apply_move(GameState& gs, move_vector m){
         clear_b_check(gs.state);
 
         // set check status for opposing white king:
-        if(is_checked(gs,w_king_x(gs.king_pos),w_king_y(gs.king_pos),BLACK)){
+        if(move_gives_check(gs, moved_p, moved_sq, vacated_sq, vacated_sq2, 
+                            (w_king_y(gs.king_pos)<<3) | w_king_x(gs.king_pos), BLACK)){
             set_w_check(gs.state);
         }
     }
 }
 
-void undo_move(GameState& gs, move_vector m){
+void apply_move(GameState& gs, move_vector m, move_undo_stack& undo){
+    undo.push_back({ gs.state, gs.king_pos, captured_piece(gs, m) });
+    apply_move(gs, m);
+}
+
+void undo_move(GameState& gs, move_vector m, move_undo_stack& undo){
+
+    assert(!undo.empty());
+    const move_undo& prev = undo.back();
 
     int x0, y0, x1, y1;
     x0 = src_x(m);
@@ -422,182 +597,61 @@ void undo_move(GameState& gs, move_vector m){
     x1 = dest_x(m);
     y1 = dest_y(m);
 
-    piece src_p = gs.get_piece(x0,y0);
     piece dest_p = gs.get_piece(x1,y1);
-    piece cap_p  = captured_piece(m);
-    piece prom_p = promoted_piece(m);
-    color dest_color = get_color(dest_p);
-    color oth_color = !dest_color;
-    assert(!src_p);
-
-    if(prom_p){
-            // undo pawn promotion:
-            assert(prom_p == dest_p);
-            assert(!is_king(prom_p));
-            assert(!is_pawn(prom_p));
-            if(dest_color == WHITE){
-                assert(y1 == 7);
-                assert(y0 == 6);
-                gs.set_piece(x0, y0, W_PAWN);
-            } else {
-                assert(y1 == 0);
-                assert(y0 == 1);
-                gs.set_piece(x0, y0, B_PAWN);
-            }
-
-            // return any pawn-captured piece:
-            gs.set_piece(x1, y1, cap_p);
-
-    } else if(cap_p){
-
-        assert(get_color(cap_p) == oth_color);
-        assert(!is_king(cap_p));
-
-        if(is_en_passant(m)){
+    assert(!gs.get_piece(x0,y0));
 
-            // undo an en passant capture:
-            assert(is_pawn(cap_p));
-            //assert(prev_en_passant(m));
-            //assert(prev_en_passant_x(m) == x1);
-            if(oth_color == WHITE){
-                assert(gs.get_piece(x1,y1+1) == NONE);
-                assert(y1 == 2);
-                gs.set_piece(x1,y1+1,W_PAWN);
-            } else {
-                assert(gs.get_piece(x1,y1-1) == NONE);
-                assert(y1 == 5);
-                gs.set_piece(x1, y1-1, B_PAWN);
-            }
-            gs.set_piece(x1,y1, NONE);
-
-        } else {
-            gs.set_piece(x1, y1, cap_p);
-        }
+    if(is_rcastle(m)){
 
-        gs.set_piece(x0, y0, dest_p);
-    
-    } else if(is_rcastle(m)){
-        
         // validate positions (and color) after castling:
-        assert(x0 == 4 && x1 == 7);
-        assert(y0 == y1);
+        assert(x0 == 4 && y0 == y1);
         assert(get_color(gs.get_piece(5,y0)) == get_color(gs.get_piece(6,y0)));
         assert(is_king(gs.get_piece(6,y0)));
         assert(is_rook(gs.get_piece(5,y0)));
-        assert(!src_p);
-        assert(!dest_p);
-        dest_p = gs.get_piece(6,y0);
-        dest_color = get_color(dest_p);
-        oth_color = !dest_color;
 
         // undo a right castle:
+        gs.set_piece(4,y0,gs.get_piece(6,y0));
+        gs.set_piece(7,y0,gs.get_piece(5,y0));
         gs.set_piece(5,y0,NONE);
         gs.set_piece(6,y0,NONE);
-        if(dest_color == WHITE){
-            gs.set_piece(4,y0,W_KING);
-            gs.set_piece(7,y0,W_ROOK);
-        } else {
-            gs.set_piece(4,y0,B_KING);
-            gs.set_piece(7,y0,B_ROOK);
-        }
 
     } else if(is_lcastle(m)){
-        
+
         // validate castling positions (and color) after castling:
-        assert(x0 == 4 && x1 == 0);
-        assert(y0 == y1);
+        assert(x0 == 4 && y0 == y1);
         assert(get_color(gs.get_piece(2,y0)) == get_color(gs.get_piece(3,y0)));
         assert(is_king(gs.get_piece(2,y0)));
         assert(is_rook(gs.get_piece(3,y0)));
-        assert(!src_p);
-        assert(!dest_p);
-        dest_p = gs.get_piece(2,y0);
-        dest_color = get_color(dest_p);
-        oth_color = !dest_color;
-        
+
         // undo a left castle:
-        gs.set_piece(2,y0, NONE);
+        gs.set_piece(4,y0,gs.get_piece(2,y0));
+        gs.set_piece(0,y0,gs.get_piece(3,y0));
+        gs.set_piece(2,y0,NONE);
         gs.set_piece(3,y0,NONE);
-        if(dest_color == WHITE){
-            gs.set_piece(0,y0,W_ROOK);
-            gs.set_piece(4,y0,W_KING);
-        } else {
-            gs.set_piece(0,y0,B_ROOK);
-            gs.set_piece(4,y0,B_KING);
-        }
 
     } else {
-        // undo a simple move:
         assert(dest_p);
-        gs.set_piece(x0, y0, dest_p);
-        gs.set_piece(x1, y1, NONE);
-    }
-
-    if(dest_color == WHITE){
-
-        // restore white en passant bits:
-        clear_w_en_passant(gs.state);
-        if(prev_en_passant(m)){
-            assert(0 <= prev_en_passant_x(m) && prev_en_passant_x(m) < 8);
-            set_w_en_passant_x(gs.state, prev_en_passant_x(m));
-        }
-
-        // restore castle bits:
-        if(prev_lcastle(m)){ set_w_can_lcastle(gs.state); }
-        if(prev_rcastle(m)){ set_w_can_rcastle(gs.state); }
-        if(prev_oth_lcastle(m)){ set_b_can_lcastle(gs.state); }
-        if(prev_oth_rcastle(m)){ set_b_can_rcastle(gs.state); }
 
-        // restore white king position:
-        if(dest_p == W_KING){
-            set_w_king_pos(gs.king_pos, x0, y0);
-        }
-
-        // restore white check status:
-        if(prev_check(m)){
-            set_w_check(gs.state);
-        } else {
-            clear_w_check(gs.state);
-        }
-
-        // clear black opponent check status:
-        // (undoing a move will never cause the opponent to leave check)
-        clear_b_check(gs.state);
-
-    } else {
-        
-        // restore black en passant bits:
-        clear_b_en_passant(gs.state);
-        if(prev_en_passant(m)){
-            assert(0 <= prev_en_passant_x(m) && prev_en_passant_x(m) < 8);
-            set_b_en_passant_x(gs.state, prev_en_passant_x(m));
-        }
-
-        // restore black castle bits:
-        if(prev_lcastle(m)){ set_b_can_lcastle(gs.state); }
-        if(prev_rcastle(m)){ set_b_can_rcastle(gs.state); }
-        if(prev_oth_lcastle(m)){ set_w_can_lcastle(gs.state); }
-        if(prev_oth_rcastle(m)){ set_w_can_rcastle(gs.state); }
-
-        // restore black king position:
-        if(dest_p == B_KING){
-            set_b_king_pos(gs.king_pos, x0, y0);
+        // undo pawn promotion:
+        if(promoted_piece(m)){
+            assert(promoted_piece(m) == dest_p);
+            dest_p = (is_white(dest_p))? W_PAWN : B_PAWN;
         }
+        gs.set_piece(x0, y0, dest_p);
 
-        // restore black check status:
-        if(prev_check(m)){
-            set_b_check(gs.state);
+        // return any captured piece:
+        if(is_en_passant(m)){
+            assert(is_pawn(prev.captured));
+            gs.set_piece(x1, y1, NONE);
+            gs.set_piece(x1, y0, prev.captured);
         } else {
-            clear_b_check(gs.state);
+            gs.set_piece(x1, y1, prev.captured);
         }
-
-        // clear white opponent check status:
-        // (undoing a move will never cause the opponent to leave check)
-        clear_w_check(gs.state);
     }
 
-    // clear any final status bits:
-    clear_final_status_bits(gs.state);
+    // restore the state bits (castling, en passant, check) and king positions:
+    gs.state = prev.state;
+    gs.king_pos = prev.king_pos;
+    undo.pop_back();
 }
 
 bool is_checked(GameState& gs, int x, int y, color attacker){
@@ -706,7 +760,7 @@ bool is_checked(GameState& gs, int x, int y, color attacker){
 
     // check for knight attacks:
     const int KNIGHT_DX[8] = { 2, 1, -1, -2, -2, -1,  1, 2 };
-    const int KNIGHT_DY[8] = { 1, 2,  2,  1, -1, -2, -2, 1 };
+    const int KNIGHT_DY[8] = { 1, 2,  2,  1, -1, -2, -2, -1 };
     for(int i = 0; i < 8; ++i){
         xt = x+KNIGHT_DX[i];
         yt = y+KNIGHT_DY[i];
@@ -721,7 +775,7 @@ bool is_checked(GameState& gs, int x, int y, color attacker){
     // check for pawn and king attacks:
     if(attacker == WHITE){
         yt = y-1;
-        if(yt > 1 && ( (x < 7 && gs.get_piece(x+1,yt) == W_PAWN) 
+        if(yt >= 1 && ( (x < 7 && gs.get_piece(x+1,yt) == W_PAWN) 
                     || (x > 0 && gs.get_piece(x-1,yt) == W_PAWN))){
             return true;
         } else if (abs(w_king_x(gs.king_pos) - x) <= 1 
@@ -732,7 +786,7 @@ bool is_checked(GameState& gs, int x, int y, color attacker){
 
     } else {
         yt = y+1;
-        if (yt < 6 && (  (x < 7 && gs.get_piece(x+1,yt) == B_PAWN)
+        if (yt <= 6 && (  (x < 7 && gs.get_piece(x+1,yt) == B_PAWN)
                      ||  (x > 0 && gs.get_piece(x-1,yt) == B_PAWN))){
             return true;
         } else if( abs(b_king_x(gs.king_pos)-x) <= 1 
@@ -745,63 +799,68 @@ bool is_checked(GameState& gs, int x, int y, color attacker){
     return false;
 }
 
-vector<move_vector> get_valid_moves(GameState& gs, color player){
-    move_vector m = 0;
+bool has_insufficient_material(const GameState& gs){
 
-    vector<move_vector> valid_moves = vector<move_vector>();
+    // any pawn, rook or queen can still force mate:
+    if(gs.piece_counts[W_PAWN]  || gs.piece_counts[B_PAWN]  ||
+       gs.piece_counts[W_ROOK]  || gs.piece_counts[B_ROOK]  ||
+       gs.piece_counts[W_QUEEN] || gs.piece_counts[B_QUEEN]){
+        return false;
+    }
 
-    // initialize previous data in m:
-    if(player == WHITE){
-        if(w_check(gs.state)){ set_prev_check(m); }
-        if(w_can_rcastle(gs.state)){ set_prev_rcastle(m); }
-        if(w_can_lcastle(gs.state)){ set_prev_lcastle(m); }
-        if(b_can_rcastle(gs.state)){ set_prev_oth_rcastle(m); }
-        if(b_can_lcastle(gs.state)){ set_prev_oth_lcastle(m); }
-        if(w_en_passant(gs.state)){ set_prev_en_passant_x(m, w_en_passant_x(gs.state)); }
+    // bare kings, or a single minor piece:
+    int n_knights = gs.piece_counts[W_KNIGHT] + gs.piece_counts[B_KNIGHT];
+    int n_bishops = gs.piece_counts[W_BISHOP] + gs.piece_counts[B_BISHOP];
+    if(n_knights + n_bishops <= 1){ return true; }
+    if(n_knights){ return false; }
+
+    // only bishops, which cannot mate if they are all on the same square color:
+    const uint64_t LIGHT_SQUARES = 0x55AA55AA55AA55AAULL;
+    uint64_t bishops = (gs.occupancy[WHITE] | gs.occupancy[BLACK]) &
+        ~((1ULL << ((w_king_y(gs.king_pos)<<3) | w_king_x(gs.king_pos))) |
+          (1ULL << ((b_king_y(gs.king_pos)<<3) | b_king_x(gs.king_pos))));
+    return !(bishops & LIGHT_SQUARES) || !(bishops & ~LIGHT_SQUARES);
+}
+
+void add_valid_piece_moves(GameState& gs, color player, int k, int gen, vector<move_vector>& moves){
+    move_vector m = 0;
+    piece p = gs.board[k];
+    int x = k&7, y = k>>3;
+
+    assert(p && get_color(p) == player);
+    if(is_pawn(p)){
+        add_valid_pawn_moves(gs, player, m, x, y, gen, moves);
+    } else if(is_rook(p)){
+        add_valid_rectilinear_moves(gs, player, m, x, y, gen, moves);
+    } else if(is_knight(p)){
+        add_valid_knight_moves(gs, player, m, x, y, gen, moves);
+    } else if(is_bishop(p)){
+        add_valid_diagonal_moves(gs, player, m, x, y, gen, moves);
+    } else if(is_queen(p)){
+        add_valid_rectilinear_moves(gs, player, m, x, y, gen, moves);
+        add_valid_diagonal_moves(gs, player, m, x, y, gen, moves);
     } else {
-        if(b_check(gs.state)){ set_prev_check(m); }
-        if(b_can_rcastle(gs.state)){ set_prev_rcastle(m); }
-        if(b_can_lcastle(gs.state)){ set_prev_lcastle(m); }
-        if(w_can_rcastle(gs.state)){ set_prev_oth_rcastle(m); }
-        if(w_can_lcastle(gs.state)){ set_prev_oth_lcastle(m); }
-        if(b_en_passant(gs.state)){ set_prev_en_passant_x(m, b_en_passant_x(gs.state)); }
+        assert(is_king(p));
+        add_valid_king_moves(gs, player, m, x, y, gen, moves);
     }
+}
 
-    //TODO: Keep track of insufficient mating material:
+vector<move_vector> get_valid_moves(GameState& gs, color player){
 
-    // iterate over board:
-    int i, x, y;
-    piece p;
-    bool only_kings_left = true;
-    for(i = 0; i < 64; ++i){
-        p = gs.board[i];
-        if(p && get_color(p) == player){
-            x = i&7; y = i>>3;
-            if(is_pawn(p)){
-                add_valid_pawn_moves(gs, player, m, x, y, valid_moves);
-            } else if(is_rook(p)){
-                add_valid_rectilinear_moves(gs, player, m, x, y, valid_moves);
-            } else if(is_knight(p)){
-                add_valid_knight_moves(gs, player, m, x, y, valid_moves);
-            } else if(is_bishop(p)){
-                add_valid_diagonal_moves(gs, player, m, x, y, valid_moves);
-            } else if(is_queen(p)){
-                add_valid_rectilinear_moves(gs, player, m, x, y, valid_moves);
-                add_valid_diagonal_moves(gs, player, m, x, y, valid_moves);
-            } else {
-                assert(is_king(p));
-                add_valid_king_moves(gs, player, m, x, y, valid_moves);
-            }
-        }
-        if(only_kings_left && p && !is_king(p)){ only_kings_left = false; }
-    }
+    vector<move_vector> valid_moves = vector<move_vector>();
 
-    // if only kings are left, return a draw state:
-    if(only_kings_left){
+    // if neither side can mate, return a draw state:
+    if(has_insufficient_material(gs)){
         set_draw(gs.state);
-        return vector<move_vector>();
+        return valid_moves;
+    }
+
+    // iterate over the occupied squares of the player:
+    for(uint64_t occ = gs.occupancy[player]; occ; occ &= occ - 1){
+        add_valid_piece_moves(gs, player, __builtin_ctzll(occ), GEN_ALL, valid_moves);
+    }
 
-    } else if(valid_moves.empty()){
+    if(valid_moves.empty()){
 
         // if no moves are available, set draw or checkmate status:
         if(player == WHITE && w_check(gs.state)){
@@ -818,7 +877,7 @@ vector<move_vector> get_valid_moves(GameState& gs, color player){
 
 
 inline void add_valid_pawn_moves(GameState& gs, color player, move_vector base_m, int x, int y, 
-                                 vector<move_vector>& moves){
+                                 int gen, vector<move_vector>& moves){
     
     assert(is_pawn(gs.get_piece(x,y)));
     assert(get_color(gs.get_piece(x,y)) == player);
@@ -839,10 +898,11 @@ inline void add_valid_pawn_moves(GameState& gs, color player, move_vector base_m
     for(int dx = -1; dx <= 1; dx += 2){
         xt = x+dx;
         // check capture in dx direction:
-        if(0 <= xt && xt < 8 && (cap_p = gs.get_piece(xt,yt)) && get_color(cap_p) != player && !is_king(cap_p)){
+        cap_p = (0 <= xt && xt < 8)? gs.get_piece(xt,yt) : NONE;
+        if(!(gen & GEN_CAPTURES)){ continue; }
+        if(cap_p && get_color(cap_p) != player && !is_king(cap_p)){
             m2 = base_m;
             set_dest_pos(m2,xt,yt);
-            set_captured_piece(m2, cap_p);
             if(player == WHITE && yt == 7){
                 for(piece prom_p : W_PROMOTIONS){
                     set_promoted_piece(m2, prom_p);
@@ -863,13 +923,11 @@ inline void add_valid_pawn_moves(GameState& gs, color player, move_vector base_m
             if(player == WHITE && yt == 5 && gs.get_piece(xt,y) == B_PAWN && b_en_passant(gs.state) && b_en_passant_x(gs.state) == xt){
                 m2 = base_m;
                 set_dest_pos(m2, xt,yt);
-                set_captured_piece(m2, B_PAWN);
                 set_en_passant(m2);
                 if(!move_will_check_king(gs, m2, player)){ moves.push_back(m2); }
             } else if(player == BLACK && yt == 2 && gs.get_piece(xt,y) == W_PAWN && w_en_passant(gs.state) && w_en_passant_x(gs.state) == xt){
                 m2 = base_m;
                 set_dest_pos(m2, xt,yt);
-                set_captured_piece(m2, W_PAWN);
                 set_en_passant(m2);
                 if(!move_will_check_king(gs, m2, player)){ moves.push_back(m2); }
             }
@@ -877,7 +935,7 @@ inline void add_valid_pawn_moves(GameState& gs, color player, move_vector base_m
     }
 
     // check for forward move (and pawn promotions):
-    if(!gs.get_piece(x,yt)){
+    if((gen & GEN_QUIETS) && !gs.get_piece(x,yt)){
         m2 = base_m;
         set_dest_pos(m2,x,yt);
         if(player == WHITE && yt == 7){
@@ -905,7 +963,7 @@ inline void add_valid_pawn_moves(GameState& gs, color player, move_vector base_m
     }
 }
 
-inline void add_valid_rectilinear_moves(GameState& gs, color player, move_vector base_m, int x, int y, vector<move_vector>& moves){
+inline void add_valid_rectilinear_moves(GameState& gs, color player, move_vector base_m, int x, int y, int gen, vector<move_vector>& moves){
     
     const int RECT_DX[4] = { 1,  0, -1,  0 };
     const int RECT_DY[4] = { 0,  1,  0, -1 };
@@ -927,20 +985,19 @@ inline void add_valid_rectilinear_moves(GameState& gs, color player, move_vector
             set_dest_pos(m2, xt, yt);
             cap_p = gs.get_piece(xt, yt);
             if(cap_p){
-                set_captured_piece(m2, cap_p);
-                if(get_color(cap_p) != player && !is_king(cap_p) && !move_will_check_king(gs, m2, player)){ 
+                if((gen & GEN_CAPTURES) && get_color(cap_p) != player && !is_king(cap_p) && !move_will_check_king(gs, m2, player)){ 
                     moves.push_back(m2);
                 }
                 break;
             }
-            if(!move_will_check_king(gs, m2, player)){ moves.push_back(m2); }
+            if((gen & GEN_QUIETS) && !move_will_check_king(gs, m2, player)){ moves.push_back(m2); }
             xt += dx;
             yt += dy;
         }
     }
 }
 
-inline void add_valid_knight_moves(GameState& gs, color player, move_vector base_m, int x, int y, vector<move_vector>& moves){
+inline void add_valid_knight_moves(GameState& gs, color player, move_vector base_m, int x, int y, int gen, vector<move_vector>& moves){
     assert(is_knight(gs.get_piece(x,y)));
     assert(get_color(gs.get_piece(x,y)) == player);
 
@@ -961,18 +1018,17 @@ inline void add_valid_knight_moves(GameState& gs, color player, move_vector base
             cap_p = gs.get_piece(xt, yt);
             set_dest_pos(m2, xt, yt);
             if(cap_p){
-                set_captured_piece(m2, cap_p);
-                if(get_color(cap_p) != player && !is_king(cap_p) && !move_will_check_king(gs, m2, player)){
+                if((gen & GEN_CAPTURES) && get_color(cap_p) != player && !is_king(cap_p) && !move_will_check_king(gs, m2, player)){
                     moves.push_back(m2);
                 }
-            } else if(!move_will_check_king(gs, m2, player)){
+            } else if((gen & GEN_QUIETS) && !move_will_check_king(gs, m2, player)){
                 moves.push_back(m2);
             }
         }
     }
 }
 
-inline void add_valid_diagonal_moves(GameState& gs, color player, move_vector base_m, int x, int y, vector<move_vector>& moves){
+inline void add_valid_diagonal_moves(GameState& gs, color player, move_vector base_m, int x, int y, int gen, vector<move_vector>& moves){
     
     const int DIAG_DX[4] = { 1, -1, -1,  1 };
     const int DIAG_DY[4] = { 1,  1, -1, -1 };
@@ -994,20 +1050,19 @@ inline void add_valid_diagonal_moves(GameState& gs, color player, move_vector ba
             set_dest_pos(m2, xt, yt);
             cap_p = gs.get_piece(xt, yt);
             if(cap_p){
-                set_captured_piece(m2, cap_p);
-                if(get_color(cap_p) != player && !is_king(cap_p) && !move_will_check_king(gs, m2, player)){ 
+                if((gen & GEN_CAPTURES) && get_color(cap_p) != player && !is_king(cap_p) && !move_will_check_king(gs, m2, player)){ 
                     moves.push_back(m2);
                 }
                 break;
             }
-            if(!move_will_check_king(gs, m2, player)){ moves.push_back(m2); }
+            if((gen & GEN_QUIETS) && !move_will_check_king(gs, m2, player)){ moves.push_back(m2); }
             xt += dx;
             yt += dy;
         }
     }
 }
 
-inline void add_valid_king_moves(GameState& gs, color player, move_vector base_m, int x, int y, vector<move_vector>& moves){
+inline void add_valid_king_moves(GameState& gs, color player, move_vector base_m, int x, int y, int gen, vector<move_vector>& moves){
 
     const int KING_DX[8] = { 1,  1,  0, -1, -1, -1,  0,  1 };
     const int KING_DY[8] = { 0,  1,  1,  1,  0, -1, -1, -1 };
@@ -1030,16 +1085,17 @@ inline void add_valid_king_moves(GameState& gs, color player, move_vector base_m
             set_dest_pos(m2, xt, yt);
             cap_p = gs.get_piece(xt, yt);
             if(cap_p){ 
-                set_captured_piece(m2, cap_p);
-                if(get_color(cap_p) != player && !is_king(cap_p) && !move_will_check_king(gs, m2, player)){ 
+                if((gen & GEN_CAPTURES) && get_color(cap_p) != player && !is_king(cap_p) && !move_will_check_king(gs, m2, player)){ 
                     moves.push_back(m2);
                 }
-            } else if(!move_will_check_king(gs, m2, player)) {
+            } else if((gen & GEN_QUIETS) && !move_will_check_king(gs, m2, player)) {
                 moves.push_back(m2);
             }
         }
     }
 
+    if(!(gen & GEN_QUIETS)){ return; }
+
     // check for valid left castling moves:
     if((player == WHITE && w_can_lcastle(gs.state)) || (player == BLACK && b_can_lcastle(gs.state)) ){
         assert(y == 0 || y == 7);
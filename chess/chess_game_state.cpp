@@ -17,6 +17,10 @@ GameState::GameState(){
     };
     
     // place pieces:
+    board.fill(NONE);
+    occupancy.fill(0);
+    piece_counts.fill(0);
+    board_key = 0;
     for(int i = 0; i < 8; ++i){
         set_piece(i,0,W_ROW[i]);
         set_piece(i,1,W_PAWN);
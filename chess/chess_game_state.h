@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <array>
+#include <cstdint>
 #include <vector>
 
 using namespace std;
@@ -117,8 +118,39 @@ inline void clear_b_en_passant(data_vector& s){ s &= ~((7<<13) | B_EN_PASSANT);
 inline void clear_draw(data_vector& s){ s &= ~DRAW; }
 inline void clear_final_status_bits(data_vector& s){ s &= ~(DRAW | W_CHECKMATE | B_CHECKMATE); }
 
+// (castling and en passant rights, which distinguish otherwise identical positions)
+const int POSITION_RIGHTS = W_CAN_RCASTLE | W_CAN_LCASTLE | B_CAN_RCASTLE | B_CAN_LCASTLE | 
+                            (15<<8) | (15<<12);
+
 typedef int position_vector;
 
+// zobrist keys of each (piece, square) and of the player to move:
+struct zobrist_table {
+    uint64_t pieces[16][64];
+    uint64_t black_to_move;
+};
+
+constexpr uint64_t zobrist_mix(uint64_t x){
+    // (splitmix64 finalizer)
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+constexpr zobrist_table make_zobrist_table(){
+    zobrist_table z{};
+    uint64_t seed = 0x9e3779b97f4a7c15ULL;
+    for(int p = 0; p < 16; ++p){
+        for(int k = 0; k < 64; ++k){
+            z.pieces[p][k] = (p == NONE)? 0 : zobrist_mix(seed += 0x9e3779b97f4a7c15ULL);
+        }
+    }
+    z.black_to_move = zobrist_mix(seed += 0x9e3779b97f4a7c15ULL);
+    return z;
+}
+
+constexpr zobrist_table ZOBRIST = make_zobrist_table();
+
 inline int w_king_x(position_vector v){ return v & 7; }
 inline int w_king_y(position_vector v){ return (v>>3) & 7; }
 inline int b_king_x(position_vector v){ return (v>>6) & 7; }
@@ -134,6 +166,13 @@ struct GameState {
     data_vector state;
     position_vector king_pos;
 
+    // occupied squares of each color (bit k is board[k]), and the
+    // number of each piece on the board. These are kept up to date by
+    // set_piece(), so all board writes must go through it:
+    array<uint64_t,2> occupancy;
+    array<uint8_t,16> piece_counts;
+    uint64_t board_key;     // (zobrist key of the board pieces)
+
     GameState();
     
     inline piece get_piece(int x, int y) const {
@@ -141,13 +180,31 @@ struct GameState {
     }
     
     inline void set_piece(int x, int y, piece p){
-        board[(y<<3) | x] = p;
+        int k = (y<<3) | x;
+        piece prev_p = board[k];
+        if(prev_p){
+            occupancy[prev_p & 1] &= ~(1ULL << k);
+            --piece_counts[prev_p];
+            board_key ^= ZOBRIST.pieces[prev_p][k];
+        }
+        if(p){
+            occupancy[p & 1] |= (1ULL << k);
+            ++piece_counts[p];
+            board_key ^= ZOBRIST.pieces[p][k];
+        }
+        board[k] = p;
     }
     
     friend ostream& operator<<(ostream& os, const GameState& s);
     friend bool operator==(const GameState& lhs, const GameState& rhs);
 };
 
+// key of the position (board, rights and player to move) for repetition detection:
+inline uint64_t position_key(const GameState& gs, color player_to_move){
+    return gs.board_key ^ zobrist_mix(gs.state & POSITION_RIGHTS) ^ 
+           (player_to_move? ZOBRIST.black_to_move : 0);
+}
+
 /*
 struct GameStateHasher {
     size_t operator()(const GameState& gs) const {
@@ -0,0 +1,71 @@
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+#include "chess_heuristic_evaluator.h"
+#include "util/timer.h"
+
+// indexed by (piece >> 1): none, pawn, rook, knight, bishop, queen, king
+const double PIECE_MATERIAL[8] = { 0.0, 1.0, 5.0, 3.0, 3.0, 9.0, 0.0, 0.0 };
+
+double get_piece_material(piece p){
+    return PIECE_MATERIAL[(p >> 1) & 0x7];
+}
+
+ChessHeuristicEvaluator::ChessHeuristicEvaluator(double latency, double value_scale, double temperature){
+    assert(value_scale > 0.0);
+    assert(temperature > 0.0);
+    this->latency = latency;
+    this->value_scale = value_scale;
+    this->temperature = temperature;
+}
+
+double ChessHeuristicEvaluator::evaluate(GameState& gs, color player_to_move,
+                    vector<move_vector>& actions, vector<double>& prob_estimates){
+
+    // ensure actions is nonempty:
+    assert(actions.size() > 0);
+    util::monotonic_stopwatch timer;
+
+    // value the material balance (from white's perspective):
+    double material = 0.0;
+    for(piece p : gs.board){
+        if(p){ material += (is_white(p))? get_piece_material(p) : -get_piece_material(p); }
+    }
+    double value = tanh(material / value_scale);
+
+    // score moves (captures by MVV-LVA, then promotions):
+    prob_estimates.resize(actions.size());
+    double max_score = -1.0E+36;
+    for(unsigned int i = 0; i < actions.size(); ++i){
+        move_vector a = actions[i];
+        double score = 0.0;
+        piece cap_p = captured_piece(gs, a);
+        if(cap_p){
+            score += get_piece_material(cap_p)
+                - 0.1*get_piece_material(gs.get_piece(src_x(a), src_y(a)));
+        }
+        if(promoted_piece(a)){
+            score += get_piece_material(promoted_piece(a)) - 1.0;
+        }
+        prob_estimates[i] = score;
+        max_score = max(max_score, score);
+    }
+
+    // convert scores to priors (softmax):
+    double prob_sum = 0.0;
+    for(double &p : prob_estimates){
+        p = exp((p - max_score) / temperature);
+        prob_sum += p;
+    }
+    for(double &p : prob_estimates){ p /= prob_sum; }
+
+    // simulate the latency of a network evaluation:
+    double run_time = timer.elapsed_time<double, chrono::duration<double>>();
+    while(run_time < latency){
+        run_time = timer.elapsed_time<double, chrono::duration<double>>();
+    }
+
+    stats->record_call(1, 0.0, 0.0, run_time, 0.0);
+    return value;
+}
@@ -0,0 +1,34 @@
+#ifndef CHESS_HEURISTIC_EVALUATOR_H
+#define CHESS_HEURISTIC_EVALUATOR_H
+
+#include "chess_evaluator.h"
+
+/**
+ * Deterministic stand-in for the network evaluator (no TensorFlow needed).
+ *
+ *  The value is the squashed material balance, tanh(material / value_scale),
+ *  and the priors favour captures of valuable pieces by cheap ones (MVV-LVA)
+ *  and promotions, through a softmax over move scores with the given
+ *  temperature. Each call busy-waits until at least `latency` seconds have
+ *  passed, to stand in for the cost of a network forward pass.
+ */
+class ChessHeuristicEvaluator : public ChessNetEvaluator {
+private:
+    double latency;
+    double value_scale;
+    double temperature;
+
+public:
+    ChessHeuristicEvaluator(double latency = 0.0, double value_scale = 10.0, double temperature = 2.0);
+
+    double evaluate(GameState& gs, color player_to_move,
+                    vector<move_vector>& actions, vector<double>& prob_estimates);
+
+    void set_latency(double latency){ this->latency = latency; }
+    double get_latency(){ return latency; }
+};
+
+// material value of a piece (in pawns, the king counts as 0):
+double get_piece_material(piece p);
+
+#endif /* CHESS_HEURISTIC_EVALUATOR_H */
@@ -0,0 +1,84 @@
+#include <cmath>
+#include <sstream>
+
+#include "chess_inference_stats.h"
+
+ChessNetInferenceStats::ChessNetInferenceStats(){
+    reset();
+}
+
+void ChessNetInferenceStats::record_call(unsigned int batch_size, double queue_wait,
+                                         double prepare_time, double run_time, double decode_time){
+
+    // determine latency bucket (4 per doubling, starting at 1us):
+    double latency_us = run_time * 1.0E6;
+    int bucket = (latency_us > 1.0)? static_cast<int>(4.0*log2(latency_us)) : 0;
+    if(bucket >= static_cast<int>(N_LATENCY_BUCKETS)){ bucket = N_LATENCY_BUCKETS-1; }
+
+    lock_guard<mutex> lock(stats_mutex);
+    ++n_calls;
+    n_positions += batch_size;
+    ++batch_sizes[batch_size];
+    total_queue_wait += queue_wait;
+    total_prepare_time += prepare_time;
+    total_run_time += run_time;
+    total_decode_time += decode_time;
+    ++run_latency_counts[bucket];
+}
+
+void ChessNetInferenceStats::reset(){
+    lock_guard<mutex> lock(stats_mutex);
+    n_calls = 0;
+    n_positions = 0;
+    batch_sizes.clear();
+    total_queue_wait = 0.0;
+    total_prepare_time = 0.0;
+    total_run_time = 0.0;
+    total_decode_time = 0.0;
+    run_latency_counts.fill(0);
+}
+
+uint64_t ChessNetInferenceStats::get_n_calls() const {
+    lock_guard<mutex> lock(stats_mutex);
+    return n_calls;
+}
+
+uint64_t ChessNetInferenceStats::get_n_positions() const {
+    lock_guard<mutex> lock(stats_mutex);
+    return n_positions;
+}
+
+double ChessNetInferenceStats::get_latency_percentile(double q) const {
+    if(n_calls == 0){ return 0.0; }
+
+    // find the first bucket at which the cumulative count reaches q:
+    double target = q * static_cast<double>(n_calls);
+    uint64_t count = 0;
+    unsigned int bucket = 0;
+    for(; bucket < N_LATENCY_BUCKETS-1; ++bucket){
+        count += run_latency_counts[bucket];
+        if(static_cast<double>(count) >= target && count > 0){ break; }
+    }
+
+    // return the upper bound of the bucket (in seconds):
+    return exp2(static_cast<double>(bucket+1) / 4.0) * 1.0E-6;
+}
+
+double ChessNetInferenceStats::get_run_latency_percentile(double q) const {
+    lock_guard<mutex> lock(stats_mutex);
+    return get_latency_percentile(q);
+}
+
+double ChessNetInferenceStats::get_positions_per_sec() const {
+    lock_guard<mutex> lock(stats_mutex);
+    return (total_run_time > 0.0)? static_cast<double>(n_positions) / total_run_time : 0.0;
+}
+
+string ChessNetInferenceStats::to_json() const {
+    stringstream ss;
+    {
+        cereal::JSONOutputArchive archive_out(ss);
+        save(archive_out);
+    }
+    return ss.str();
+}
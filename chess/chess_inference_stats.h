@@ -0,0 +1,85 @@
+#ifndef CHESS_INFERENCE_STATS_H
+#define CHESS_INFERENCE_STATS_H
+
+#include <array>
+#include <map>
+#include <mutex>
+#include <string>
+#include <cstdint>
+
+#include <cereal/cereal.hpp>
+#include <cereal/archives/json.hpp>
+#include <cereal/types/map.hpp>
+
+using namespace std;
+
+/**
+ * Counters and histograms for network inference calls.
+ *
+ *  Each call records its batch size and the time spent waiting in a queue
+ *  (for callers that queue requests), preparing the input tensor, running
+ *  the TF session and decoding the outputs (all in seconds). Run latencies
+ *  are kept in a log-scale histogram (4 buckets per doubling, from 1us), so
+ *  reported percentiles are upper bounds accurate to within ~19%.
+ *  The stats may be shared (and recorded to) by several searches at once.
+ */
+class ChessNetInferenceStats {
+private:
+    static const unsigned int N_LATENCY_BUCKETS = 128;
+
+    mutable mutex stats_mutex;
+
+    uint64_t n_calls;
+    uint64_t n_positions;
+    map<unsigned int, uint64_t> batch_sizes;
+    double total_queue_wait;
+    double total_prepare_time;
+    double total_run_time;
+    double total_decode_time;
+    array<uint64_t, N_LATENCY_BUCKETS> run_latency_counts;
+
+    double get_latency_percentile(double q) const;
+
+public:
+    ChessNetInferenceStats();
+
+    void record_call(unsigned int batch_size, double queue_wait,
+                     double prepare_time, double run_time, double decode_time);
+
+    void reset();
+
+    uint64_t get_n_calls() const;
+    uint64_t get_n_positions() const;
+
+    // (approximate) percentile of the session run latency, q in [0,1]:
+    double get_run_latency_percentile(double q) const;
+
+    // positions evaluated per second of session run time:
+    double get_positions_per_sec() const;
+
+    template<class Archive>
+    void save(Archive& ar) const {
+        lock_guard<mutex> lock(stats_mutex);
+        double mean_batch_size = (n_calls > 0)?
+            static_cast<double>(n_positions) / static_cast<double>(n_calls) : 0.0;
+        double positions_per_sec = (total_run_time > 0.0)?
+            static_cast<double>(n_positions) / total_run_time : 0.0;
+
+        ar(cereal::make_nvp("n_calls", n_calls),
+           cereal::make_nvp("n_positions", n_positions),
+           cereal::make_nvp("mean_batch_size", mean_batch_size),
+           cereal::make_nvp("batch_sizes", batch_sizes),
+           cereal::make_nvp("queue_wait_time", total_queue_wait),
+           cereal::make_nvp("prepare_time", total_prepare_time),
+           cereal::make_nvp("run_time", total_run_time),
+           cereal::make_nvp("decode_time", total_decode_time),
+           cereal::make_nvp("run_latency_p50", get_latency_percentile(0.50)),
+           cereal::make_nvp("run_latency_p90", get_latency_percentile(0.90)),
+           cereal::make_nvp("run_latency_p99", get_latency_percentile(0.99)),
+           cereal::make_nvp("positions_per_sec", positions_per_sec));
+    }
+
+    string to_json() const;
+};
+
+#endif /* CHESS_INFERENCE_STATS_H */
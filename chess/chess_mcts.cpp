@@ -3,8 +3,6 @@
 #include "chess_mcts.h"
 #include "chess_game_logic.h"
 #include "chess_game_state.h"
-#include "cppflow/ops.h"
-#include "cppflow/model.h"
 
 ChessUniformMCTS::ChessUniformMCTS(
     GameState gs, color player_to_move, double noise) : MCTS(gs) {
@@ -12,7 +10,23 @@ ChessUniformMCTS::ChessUniformMCTS(
     this->player_to_move = player_to_move;
     this->prev_moves_since_last_capture = vector<unsigned int>();
     this->moves_since_last_capture = 0;
+    this->undo_stack = move_undo_stack();
     this->noise = noise;
+    this->position_keys = vector<uint64_t>();
+    this->position_key_counts = unordered_map<uint64_t,unsigned int>();
+    push_position_key();
+}
+
+void ChessUniformMCTS::push_position_key(){
+    uint64_t key = position_key(state, player_to_move);
+    position_keys.push_back(key);
+    ++position_key_counts[key];
+}
+
+void ChessUniformMCTS::pop_position_key(){
+    assert(!position_keys.empty());
+    --position_key_counts[position_keys.back()];
+    position_keys.pop_back();
 }
 
 bool ChessUniformMCTS::get_state_actions(vector<move_vector>& actions){
@@ -21,6 +35,11 @@ bool ChessUniformMCTS::get_state_actions(vector<move_vector>& actions){
         return false;
     }
 
+    // enforce threefold repetition:
+    if(get_repetition_count() >= 3){
+        return false;
+    }
+
     // return the valid player moves:
     if(player_to_move == WHITE){
         actions = get_valid_moves(state, WHITE);
@@ -52,9 +71,11 @@ double ChessUniformMCTS::get_state_action_estimates(vector<move_vector>& actions
 }
     
 void ChessUniformMCTS::apply_state_action(move_vector d){
-    apply_move(state, d);
+    // (captures and pawn moves reset the 50-move count)
+    bool pawn_move = is_pawn(state.board[(src_y(d)<<3) | src_x(d)]);
+    apply_move(state, d, undo_stack);
 
-    if(captured_piece(d) || is_pawn(state.board[(src_y(d)<<3) | src_x(d)])){
+    if(undo_stack.back().captured || pawn_move){
         prev_moves_since_last_capture.push_back(moves_since_last_capture);
         moves_since_last_capture = 0;
     } else {
@@ -62,14 +83,21 @@ void ChessUniformMCTS::apply_state_action(move_vector d){
     }
 
     player_to_move = !player_to_move;
+    push_position_key();
 }
 
 void ChessUniformMCTS::undo_state_action(move_vector d){
-    undo_move(state,d);
+    assert(!undo_stack.empty());
+    pop_position_key();
+#ifndef NDEBUG
+    // (the count was reset if the move was a capture)
+    bool was_capture = undo_stack.back().captured;
+#endif
+    undo_move(state, d, undo_stack);
     
     if(moves_since_last_capture <= 0){
         assert(prev_moves_since_last_capture.size() >= 1);
-        assert(captured_piece(d) || promoted_piece(d) || is_pawn(state.board[(dest_y(d)<<3) | dest_x(d)]));
+        assert(was_capture || is_pawn(state.board[(src_y(d)<<3) | src_x(d)]));
         moves_since_last_capture = prev_moves_since_last_capture.back();
         prev_moves_since_last_capture.pop_back();
     } else {
@@ -82,9 +110,14 @@ void ChessUniformMCTS::undo_state_action(move_vector d){
 
 double ChessUniformMCTS::get_final_state_value(){
 
-    auto moves = get_valid_moves(state, player_to_move);
+    // (the final status bits are set by get_state_actions when no moves remain,
+    //  so moves are only generated if it was not called on this state)
     double value = 0.0;
-    
+    if(!(state.state & (W_CHECKMATE | B_CHECKMATE | DRAW)) &&
+        moves_since_last_capture < 50 && get_repetition_count() < 3){
+        get_valid_moves(state, player_to_move);
+    }
+
     if(state.state & W_CHECKMATE){ value = -1.0; }
     if(state.state & B_CHECKMATE){ value =  1.0; }
 
@@ -92,33 +125,30 @@ double ChessUniformMCTS::get_final_state_value(){
 }
 
 size_t ChessUniformMCTS::hash_state(){
-    
-    size_t h = 0;
-    h ^= std::hash<int>{}(state.state | DRAW | W_CHECKMATE | B_CHECKMATE)
-          + 0x9e3779b9 + (h << 6) + (h >> 2);
-
-    // Apply the boost array hash:
-    //    http://www.boost.org/doc/libs/1_35_0/doc/html/boost/hash_combine_id241013.html
-    for (auto p : state.board){
-        h ^= std::hash<int>{}(p)  + 0x9e3779b9 + (h << 6) + (h >> 2); 
+
+    // (only the position is hashed: the number of moves since the last capture
+    //  is enforced as a path rule, so transpositions share a node in the tree)
+    return position_key(state, player_to_move);
+}
+
+bool ChessUniformMCTS::get_path_terminal_value(double& value){
+
+    // (loosely) enforce 50-move rule:
+    if(moves_since_last_capture >= 50){
+        value = 0.0;
+        return true;
     }
-    h ^= std::hash<int>{}(31*player_to_move)  + 0x9e3779b9 + (h << 6) + (h >> 2);
-    h ^= std::hash<int>{}(31*moves_since_last_capture)  + 0x9e3779b9 + (h << 6) + (h >> 2);
-    
-    /*
-    size_t h = (state.state | DRAW | W_CHECKMATE | B_CHECKMATE);
-    h = (h<<1) | player_to_move;
-    h = h*31 + moves_since_last_capture;
 
-    for(auto p : state.board){
-        h = h*31 + p;
+    // score any repetition in the search as a draw (the side that
+    // repeated the position can keep repeating it):
+    if(get_repetition_count() >= 2){
+        value = 0.0;
+        return true;
     }
-    */
-    
-    return h;
+    return false;
 }
 
-double ChessUniformMCTS::action_objective_function(MCTSNode& node, int action_idx){
+double ChessUniformMCTS::action_objective_function(MCTSNode<move_vector>& node, int action_idx){
     
     // maximize the Q Upper Confidence Bound (UCB) value:
     double q_factor = (player_to_move == WHITE)? 1.0 : -1.0;
@@ -130,6 +160,7 @@ double ChessUniformMCTS::action_objective_function(MCTSNode& node, int action_id
 void ChessUniformMCTS::reset_to_state(GameState gs, color player_to_move){
     
     search_path.clear();
+    search_path_nodes.clear();
     search_path_indices.clear();
 
     this->player_to_move = player_to_move;
@@ -137,68 +168,32 @@ void ChessUniformMCTS::reset_to_state(GameState gs, color player_to_move){
 
     moves_since_last_capture = 0;
     prev_moves_since_last_capture.clear();
+    undo_stack.clear();
 
+    position_keys.clear();
+    position_key_counts.clear();
+    push_position_key();
 }
 
-ChessNetMCTS::ChessNetMCTS(GameState gs, string model_path, color player_to_move, double noise) : 
-    ChessUniformMCTS(gs,player_to_move,noise), nnet(model_path){
+ChessNetMCTS::ChessNetMCTS(GameState gs, shared_ptr<ChessNetEvaluator> evaluator, color player_to_move, double noise) : 
+    ChessUniformMCTS(gs,player_to_move,noise), evaluator(evaluator){
     // constructor
 }
 
-ChessNetMCTS::ChessNetMCTS(GameState gs, cppflow::model model, color player_to_move, double noise) : 
-    ChessUniformMCTS(gs,player_to_move,noise), nnet(model){
-    // constructor
+void ChessNetMCTS::begin_search(){
+    evaluator->begin_search();
 }
 
 double ChessNetMCTS::get_state_action_estimates(vector<move_vector>& actions, vector<double>& prob_estimates){
-    
-    // ensure actions is nonempty:
-    assert(actions.size() > 0);
-    
-    // fill in board tensor (8x8x6):
-    auto input = vector<float>(8*8*6, 0.0f);    
-    for(unsigned int i = 0; i < 64; ++i){
-        piece p = state.board[i];
-        if(p){
-            int p_idx = (p>>1)-1;
-            assert(0 <= p_idx && p_idx < 6);
-            input[6*i+p_idx] = ((is_white(p))? 1.0f : -1.0f);
-        }
-    }
-
-    // reshape input to correct board size:
-    auto x_input = cppflow::tensor(input,{1,8,8,6});
-
-    // perform inference:
-    auto output = nnet({{serve_x_input, x_input}},{serve_pi_output, serve_v_output});
-    
-    // retrieve model output:
-    vector<double> output_prob_estimates = cppflow::cast(cppflow::squeeze(output[0],{0}),TF_FLOAT,TF_DOUBLE).get_data<double>();
-    double output_value = cppflow::cast(output[0],TF_FLOAT, TF_DOUBLE).get_data<double>().front();
-    assert(-1.0 <= output_value);
-    assert( 1.0 >= output_value);
-
-    // mask model output with valid moves:
-    prob_estimates.clear();
-    double prob_sum = 0.0;
-    for(auto &a : actions){
-        unsigned int idx = (src_y(a)<<9) | (src_x(a)<<6) | (dest_y(a)<<3) | dest_x(a);
-        assert(idx < output_prob_estimates.size());
-        double prob = output_prob_estimates[idx];
-        assert(prob >= 0.0);
-        prob_sum += prob;
-        prob_estimates.push_back(prob);
-    }
+    return evaluator->evaluate(state, player_to_move, actions, prob_estimates);
+}
 
-    //re-normalize probabilities:
-    for(double &p : prob_estimates){
-        if(prob_sum > 0){
-            p /= prob_sum;
-        } else {
-            p = 1.0 / prob_estimates.size();
-        }
+string ChessNetMCTS::stats_to_json(){
+    stringstream ss;
+    {
+        cereal::JSONOutputArchive archive_out(ss);
+        archive_out(cereal::make_nvp("search", stats),
+                    cereal::make_nvp("inference", *evaluator->get_stats()));
     }
-
-    // return estimated value:
-    return output_value;
+    return ss.str();
 }
\ No newline at end of file
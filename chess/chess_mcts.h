@@ -4,13 +4,12 @@
 #include <cassert>
 #include <vector>
 #include <string>
+#include <unordered_map>
 
 #include "mcts/mcts.h"
 #include "chess_game_logic.h"
 #include "chess_game_state.h"
-#include "cppflow/ops.h"
-#include "cppflow/model.h"
-#include "chessnet_config.h"
+#include "chess_evaluator.h"
 
 class ChessUniformMCTS : public MCTS<GameState,move_vector> {
 protected:
@@ -19,6 +18,15 @@ protected:
     double noise;
     unsigned int moves_since_last_capture;
     vector<unsigned int> prev_moves_since_last_capture;
+    move_undo_stack undo_stack;     // (of the moves applied to the state)
+
+    // keys of the positions reached in the game and the current search path
+    // (including the current state), and the number of times each key occurs:
+    vector<uint64_t> position_keys;
+    unordered_map<uint64_t,unsigned int> position_key_counts;
+
+    void push_position_key();
+    void pop_position_key();
 
 public:
 
@@ -36,28 +44,34 @@ public:
 
     size_t hash_state();
 
-    double action_objective_function(MCTSNode& node, int action_idx);
+    bool get_path_terminal_value(double& value);
+
+    double action_objective_function(MCTSNode<move_vector>& node, int action_idx);
 
     void reset_to_state(GameState gs, color player_to_move=WHITE);
 
     unsigned int get_moves_since_last_capture(){ return moves_since_last_capture; }
+    unsigned int get_repetition_count(){ return position_key_counts[position_keys.back()]; }
     color get_player_to_move(){ return player_to_move; }
 };
 
 class ChessNetMCTS : public ChessUniformMCTS {
 protected:
     
-    cppflow::model nnet;
-
-    const string serve_x_input = SERVE_X_INPUT;
-    const string serve_pi_output = SERVE_PI_OUTPUT;
-    const string serve_v_output = SERVE_V_OUTPUT;
+    shared_ptr<ChessNetEvaluator> evaluator;
 
 public:
 
-    ChessNetMCTS(GameState gs, string model_path, color player_to_move = WHITE, double noise = 1.0);
-    ChessNetMCTS(GameState gs, cppflow::model model, color player_to_move = WHITE, double noise = 1.0);
+    ChessNetMCTS(GameState gs, shared_ptr<ChessNetEvaluator> evaluator, color player_to_move = WHITE, double noise = 1.0);
+
+    void begin_search();
+
+    shared_ptr<ChessNetEvaluator> get_evaluator(){ return evaluator; }
+
+    unsigned int get_model_version(){ return evaluator->get_model_version(); }
 
+    // returns the search and inference stats as a JSON object:
+    string stats_to_json();
 
     double get_state_action_estimates(vector<move_vector>& actions, vector<double>& prob_estimates);
 
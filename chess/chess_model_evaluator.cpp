@@ -0,0 +1,90 @@
+#include "chess_model_evaluator.h"
+#include "chess_board_encoder.h"
+#include "util/timer.h"
+#include "cppflow/tensor.h"
+
+ChessNetModelEvaluator::ChessNetModelEvaluator(string model_path,
+                           const chessnet_session_config& session_config) :
+    nnet(get_chessnet_model_registry().get(model_path, session_config)){
+    // constructor
+}
+
+ChessNetModelEvaluator::ChessNetModelEvaluator(cppflow::model model) : nnet(model){
+    // constructor
+}
+
+ChessNetModelEvaluator::ChessNetModelEvaluator(shared_ptr<ChessNetModelSlot> model_slot) :
+    nnet(model_slot->acquire()->model), nnet_slot(model_slot){
+    begin_search();
+}
+
+void ChessNetModelEvaluator::begin_search(){
+    if(!nnet_slot){ return; }
+
+    // pick up the latest model (the previous version is released once unused).
+    // Priors already cached in the search tree were estimated by the previous
+    // version and are kept, so the statistics of earlier moves are not lost:
+    auto latest = nnet_slot->acquire();
+    if(latest != nnet_version){
+        nnet_version = latest;
+        nnet = latest->model;
+    }
+}
+
+double ChessNetModelEvaluator::evaluate(GameState& gs, color player_to_move,
+                    vector<move_vector>& actions, vector<double>& prob_estimates){
+
+    // ensure actions is nonempty:
+    assert(actions.size() > 0);
+    util::monotonic_stopwatch timer;
+
+    // fill in board tensor (8x8x6):
+    auto input = vector<float>(BOARD_ENCODING_SIZE);
+    encode_board(gs.board.data(), input.data());
+
+    // reshape input to correct board size:
+    auto x_input = cppflow::tensor(input,{1,8,8,6});
+    double prepare_end = timer.elapsed_time<double, chrono::duration<double>>();
+
+    // perform inference:
+    auto output = nnet({{serve_x_input, x_input}},{serve_pi_output, serve_v_output});
+    double run_end = timer.elapsed_time<double, chrono::duration<double>>();
+
+    // read model outputs in place (the policy and value heads are float tensors):
+    auto pi_tensor = output[0].get_tensor();
+    auto v_tensor = output[1].get_tensor();
+    assert(TF_TensorType(pi_tensor.get()) == TF_FLOAT);
+    assert(TF_TensorType(v_tensor.get()) == TF_FLOAT);
+    assert(TF_TensorByteSize(pi_tensor.get()) >= 64*64*sizeof(float));
+
+    const float* output_probs = static_cast<const float*>(TF_TensorData(pi_tensor.get()));
+    double output_value = static_cast<double>(*static_cast<const float*>(TF_TensorData(v_tensor.get())));
+    assert(-1.0 <= output_value);
+    assert( 1.0 >= output_value);
+
+    // gather valid move probabilities from the policy output:
+    prob_estimates.resize(actions.size());
+    double prob_sum = 0.0;
+    for(unsigned int i = 0; i < actions.size(); ++i){
+        move_vector a = actions[i];
+        unsigned int idx = (src_y(a)<<9) | (src_x(a)<<6) | (dest_y(a)<<3) | dest_x(a);
+        double prob = static_cast<double>(output_probs[idx]);
+        assert(prob >= 0.0);
+        prob_sum += prob;
+        prob_estimates[i] = prob;
+    }
+
+    // re-normalize probabilities:
+    if(prob_sum > 0.0){
+        double inv_prob_sum = 1.0 / prob_sum;
+        for(double &p : prob_estimates){ p *= inv_prob_sum; }
+    } else {
+        fill(prob_estimates.begin(), prob_estimates.end(), 1.0 / prob_estimates.size());
+    }
+
+    double decode_end = timer.elapsed_time<double, chrono::duration<double>>();
+    stats->record_call(1, 0.0, prepare_end, run_end - prepare_end, decode_end - run_end);
+
+    // return estimated value:
+    return output_value;
+}
@@ -0,0 +1,45 @@
+#ifndef CHESS_MODEL_EVALUATOR_H
+#define CHESS_MODEL_EVALUATOR_H
+
+#include <string>
+#include <memory>
+
+#include "chess_evaluator.h"
+#include "chess_session_config.h"
+#include "chess_model_registry.h"
+#include "chess_model_slot.h"
+#include "chessnet_config.h"
+#include "cppflow/model.h"
+
+/**
+ * Evaluates positions with the chessnet SavedModel (through cppflow).
+ *
+ *  If constructed from a model slot, the evaluator switches to the latest
+ *  published model version at the start of each search.
+ */
+class ChessNetModelEvaluator : public ChessNetEvaluator {
+private:
+    cppflow::model nnet;
+
+    shared_ptr<ChessNetModelSlot> nnet_slot;
+    shared_ptr<const chessnet_model_version> nnet_version;
+
+    const string serve_x_input = SERVE_X_INPUT;
+    const string serve_pi_output = SERVE_PI_OUTPUT;
+    const string serve_v_output = SERVE_V_OUTPUT;
+
+public:
+    ChessNetModelEvaluator(string model_path,
+                           const chessnet_session_config& session_config = chessnet_session_config());
+    ChessNetModelEvaluator(cppflow::model model);
+    ChessNetModelEvaluator(shared_ptr<ChessNetModelSlot> model_slot);
+
+    double evaluate(GameState& gs, color player_to_move,
+                    vector<move_vector>& actions, vector<double>& prob_estimates);
+
+    void begin_search();
+
+    unsigned int get_model_version(){ return (nnet_version)? nnet_version->version : 0; }
+};
+
+#endif /* CHESS_MODEL_EVALUATOR_H */
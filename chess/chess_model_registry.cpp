@@ -0,0 +1,52 @@
+#include "chess_model_registry.h"
+#include "chessnet_config.h"
+#include "util/string_ops.h"
+
+static string normalize_model_path(const string& model_path){
+    string path = util::strip(model_path);
+    while(path.size() > 1 && path.back() == '/'){ path.pop_back(); }
+    return path;
+}
+
+cppflow::model ChessNetModelRegistry::get(const string& model_path,
+                        const chessnet_session_config& config){
+
+    // (sessions are only shared between identical configs, including the CPU affinity):
+    string config_key = serialize_session_config(config);
+    for(int cpu : config.cpu_affinity){ config_key += "|" + to_string(cpu); }
+    auto key = make_pair(normalize_model_path(model_path), config_key);
+
+    lock_guard<mutex> lock(registry_mutex);
+    auto model_ptr = models.find(key);
+    if(model_ptr == models.end()){
+        model_ptr = models.emplace(key, load_chessnet_model(key.first, config)).first;
+    }
+    return model_ptr->second;
+}
+
+void ChessNetModelRegistry::release(const string& model_path){
+    string path = normalize_model_path(model_path);
+
+    lock_guard<mutex> lock(registry_mutex);
+    auto first = models.lower_bound(make_pair(path, string()));
+    auto last = first;
+    while(last != models.end() && last->first.first == path){ ++last; }
+    models.erase(first, last);
+}
+
+size_t ChessNetModelRegistry::size(){
+    lock_guard<mutex> lock(registry_mutex);
+    return models.size();
+}
+
+ChessNetModelRegistry& get_chessnet_model_registry(){
+    static ChessNetModelRegistry registry;
+    return registry;
+}
+
+string get_model_variables_path(const string& model_path){
+    string variables_path = util::strip(model_path);
+    if(variables_path.empty() || variables_path.back() != '/'){ variables_path += "/"; }
+    variables_path += MODEL_VARIABLES_DIR + "/" + MODEL_VARIABLES_NAME;
+    return variables_path;
+}
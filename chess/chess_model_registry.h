@@ -0,0 +1,52 @@
+#ifndef CHESS_MODEL_REGISTRY_H
+#define CHESS_MODEL_REGISTRY_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "cppflow/model.h"
+#include "chess_session_config.h"
+
+using namespace std;
+
+/**
+ * Loads each chessnet SavedModel once and hands out shared handles to it.
+ *
+ *  A handle is a copy of the cppflow::model, which shares the underlying
+ *  graph and session, so agents created from the same path (and session
+ *  config) do not load or hold separate copies of the weights.
+ *
+ *  Weights are not refreshed in place: a loaded model may be in use by
+ *  running searches, and cppflow can only create a session by loading a
+ *  SavedModel. After new weights are saved, the path is released and the
+ *  next get() loads the whole SavedModel again (see ChessNetSelfPlay::save_model).
+ */
+class ChessNetModelRegistry {
+private:
+    mutex registry_mutex;
+
+    // (model path, session config key) -> loaded model:
+    map<pair<string,string>, cppflow::model> models;
+
+public:
+    ChessNetModelRegistry(){}
+
+    ChessNetModelRegistry(const ChessNetModelRegistry&) = delete;
+    ChessNetModelRegistry& operator=(const ChessNetModelRegistry&) = delete;
+
+    cppflow::model get(const string& model_path,
+                        const chessnet_session_config& config = chessnet_session_config());
+
+    // drops the registry's handles (the model is freed with its last handle):
+    void release(const string& model_path);
+
+    size_t size();
+};
+
+ChessNetModelRegistry& get_chessnet_model_registry();
+
+string get_model_variables_path(const string& model_path);
+
+#endif /* CHESS_MODEL_REGISTRY_H */
@@ -0,0 +1,20 @@
+#include "chess_model_slot.h"
+
+ChessNetModelSlot::ChessNetModelSlot(cppflow::model model) : n_published(1) {
+    this->current = make_shared<const chessnet_model_version>(1, model);
+}
+
+unsigned int ChessNetModelSlot::publish(cppflow::model model){
+    lock_guard<mutex> lock(publish_mutex);
+    unsigned int version = n_published.load() + 1;
+    auto next = make_shared<const chessnet_model_version>(version, model);
+
+    // (searches holding the previous version keep it alive until they finish):
+    atomic_store(&current, next);
+    n_published.store(version);
+    return version;
+}
+
+shared_ptr<const chessnet_model_version> ChessNetModelSlot::acquire() const {
+    return atomic_load(&current);
+}
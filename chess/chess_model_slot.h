@@ -0,0 +1,48 @@
+#ifndef CHESS_MODEL_SLOT_H
+#define CHESS_MODEL_SLOT_H
+
+#include <memory>
+#include <atomic>
+#include <mutex>
+
+#include "cppflow/model.h"
+
+using namespace std;
+
+struct chessnet_model_version {
+    unsigned int version;
+    cppflow::model model;
+
+    chessnet_model_version(unsigned int version, cppflow::model model) :
+        version(version), model(model) {}
+};
+
+/**
+ * Versioned slot holding the latest published model.
+ *
+ *  Publishing swaps in a new version atomically. Searches acquire the
+ *  current version when they start and keep using it until they finish,
+ *  so weights never change underneath a running search; a version (and
+ *  its session) is released once the slot and its last user drop it.
+ */
+class ChessNetModelSlot {
+private:
+    shared_ptr<const chessnet_model_version> current;
+    atomic<unsigned int> n_published;
+    mutex publish_mutex;
+
+public:
+    ChessNetModelSlot(cppflow::model model);
+
+    ChessNetModelSlot(const ChessNetModelSlot&) = delete;
+    ChessNetModelSlot& operator=(const ChessNetModelSlot&) = delete;
+
+    // returns the version number of the published model:
+    unsigned int publish(cppflow::model model);
+
+    shared_ptr<const chessnet_model_version> acquire() const;
+
+    unsigned int get_version() const { return n_published.load(); }
+};
+
+#endif /* CHESS_MODEL_SLOT_H */
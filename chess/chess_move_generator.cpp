@@ -0,0 +1,84 @@
+#include <cassert>
+#include <algorithm>
+
+#include "chess_move_generator.h"
+
+// piece values for MVV-LVA ordering (indexed by piece type, i.e. p >> 1):
+const int MVV_LVA_VALUES[7] = {
+    0,  // NONE
+    1,  // PAWN
+    5,  // ROOK
+    3,  // KNIGHT
+    3,  // BISHOP
+    9,  // QUEEN
+    10  // KING (never captured)
+};
+
+StagedMoveGenerator::StagedMoveGenerator(GameState& gs, color player) : gs(gs) {
+    this->player = player;
+    this->stage = STAGE_START;
+    this->quiet_pieces = gs.occupancy[player];
+    this->moves = vector<move_vector>();
+    this->next_idx = 0;
+}
+
+bool StagedMoveGenerator::next(move_vector& m){
+    while(next_idx >= moves.size()){
+        if(!generate_next_stage()){ return false; }
+    }
+    m = moves[next_idx++];
+    return true;
+}
+
+bool StagedMoveGenerator::generate_next_stage(){
+
+    moves.clear();
+    next_idx = 0;
+    uint64_t occ;
+
+    switch(stage){
+        case STAGE_START:
+            // generate evasions (if in check) or captures:
+            stage = ((player == WHITE)? w_check(gs.state) : b_check(gs.state))?
+                STAGE_EVASIONS : STAGE_CAPTURES;
+            for(occ = gs.occupancy[player]; occ; occ &= occ - 1){
+                add_valid_piece_moves(gs, player, __builtin_ctzll(occ),
+                    (stage == STAGE_EVASIONS)? GEN_ALL : GEN_CAPTURES, moves);
+            }
+            sort_captures_first();
+            return true;
+
+        case STAGE_CAPTURES:
+            stage = STAGE_QUIETS;
+            [[fallthrough]];
+
+        case STAGE_QUIETS:
+            // generate the quiet moves of the next piece:
+            if(quiet_pieces){
+                add_valid_piece_moves(gs, player, __builtin_ctzll(quiet_pieces), GEN_QUIETS, moves);
+                quiet_pieces &= quiet_pieces - 1;
+                return true;
+            }
+            stage = STAGE_DONE;
+            return false;
+
+        default:
+            stage = STAGE_DONE;
+            return false;
+    }
+}
+
+void StagedMoveGenerator::sort_captures_first(){
+
+    // (quiet moves score below all captures and keep their order)
+    auto score = [this](move_vector m){
+        piece cap_p = captured_piece(gs, m);
+        if(!cap_p){ return 0; }
+        piece src_p = gs.board[(src_y(m)<<3) | src_x(m)];
+        return 16*MVV_LVA_VALUES[cap_p >> 1] - MVV_LVA_VALUES[src_p >> 1];
+    };
+
+    stable_sort(moves.begin(), moves.end(), [&score](move_vector a, move_vector b){
+        return score(a) > score(b);
+    });
+}
@@ -0,0 +1,54 @@
+#ifndef CHESS_MOVE_GENERATOR_H
+#define CHESS_MOVE_GENERATOR_H
+
+#include <cstdint>
+#include <vector>
+
+#include "chess_game_state.h"
+#include "chess_game_logic.h"
+
+enum move_stage {
+    STAGE_START,
+    STAGE_EVASIONS,     // (all moves, if the player is in check)
+    STAGE_CAPTURES,
+    STAGE_QUIETS,
+    STAGE_DONE
+};
+
+/**
+ * Generates the valid moves of a player lazily, in stages.
+ *
+ *  If the player is in check, all evasions are generated at once
+ *  (captures first). Otherwise captures are generated first, ordered by
+ *  MVV-LVA (most valuable victim, then least valuable attacker), followed
+ *  by quiet moves, which are generated one piece at a time. Each stage is
+ *  only generated once the previous one is consumed, so callers that stop
+ *  at the first acceptable move skip the rest of the move generation.
+ *
+ *  The union of all stages is the same set of moves as get_valid_moves,
+ *  but the final status bits (checkmate/draw) of the state are not set.
+ *  The state must not be modified while moves are being generated.
+ */
+class StagedMoveGenerator {
+private:
+    GameState& gs;
+    color player;
+    move_stage stage;
+    uint64_t quiet_pieces;      // (squares of the pieces with quiet moves left to generate)
+    vector<move_vector> moves;
+    size_t next_idx;
+
+    bool generate_next_stage();
+
+    void sort_captures_first();
+
+public:
+    StagedMoveGenerator(GameState& gs, color player);
+
+    // returns false once all moves have been generated:
+    bool next(move_vector& m);
+
+    move_stage get_stage() const { return stage; }
+};
+
+#endif // CHESS_MOVE_GENERATOR_H
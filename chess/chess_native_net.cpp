@@ -0,0 +1,614 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include <iostream>
+#include <algorithm>
+
+#include "chess_native_net.h"
+#include "chess_board_encoder.h"
+#include "util/timer.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHESS_NATIVE_X86
+#endif
+
+/* ---------------- kernels ---------------- */
+
+static void axpy_scalar(float a, const float* x, float* y, size_t n){
+    for(size_t i = 0; i < n; ++i){ y[i] += a*x[i]; }
+}
+
+static float dot_scalar(const float* a, const float* b, size_t n){
+    float sum = 0.0f;
+    for(size_t i = 0; i < n; ++i){ sum += a[i]*b[i]; }
+    return sum;
+}
+
+static void axpy_i8_scalar(float a, const int8_t* q, float* y, size_t n){
+    for(size_t i = 0; i < n; ++i){ y[i] += a*q[i]; }
+}
+
+static float dot_i8_scalar(const int8_t* q, const float* b, size_t n){
+    float sum = 0.0f;
+    for(size_t i = 0; i < n; ++i){ sum += q[i]*b[i]; }
+    return sum;
+}
+
+#ifdef CHESS_NATIVE_X86
+__attribute__((target("avx2,fma")))
+static inline __m256 load_i8_ps(const int8_t* q){
+    return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(q))));
+}
+
+__attribute__((target("avx2,fma")))
+static inline float hsum_avx2(__m256 v){
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 0x1));
+    return _mm_cvtss_f32(s);
+}
+
+__attribute__((target("avx2,fma")))
+static void axpy_avx2(float a, const float* x, float* y, size_t n){
+    __m256 va = _mm256_set1_ps(a);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8){
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+    }
+    for(; i < n; ++i){ y[i] += a*x[i]; }
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_avx2(const float* a, const float* b, size_t n){
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16){
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+        sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), sum1);
+    }
+    for(; i + 8 <= n; i += 8){
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+    }
+    float sum = hsum_avx2(_mm256_add_ps(sum0, sum1));
+
+    for(; i < n; ++i){ sum += a[i]*b[i]; }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+static void axpy_i8_avx2(float a, const int8_t* q, float* y, size_t n){
+    __m256 va = _mm256_set1_ps(a);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8){
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, load_i8_ps(q + i), _mm256_loadu_ps(y + i)));
+    }
+    for(; i < n; ++i){ y[i] += a*q[i]; }
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_i8_avx2(const int8_t* q, const float* b, size_t n){
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16){
+        sum0 = _mm256_fmadd_ps(load_i8_ps(q + i), _mm256_loadu_ps(b + i), sum0);
+        sum1 = _mm256_fmadd_ps(load_i8_ps(q + i + 8), _mm256_loadu_ps(b + i + 8), sum1);
+    }
+    for(; i + 8 <= n; i += 8){
+        sum0 = _mm256_fmadd_ps(load_i8_ps(q + i), _mm256_loadu_ps(b + i), sum0);
+    }
+    float sum = hsum_avx2(_mm256_add_ps(sum0, sum1));
+
+    for(; i < n; ++i){ sum += q[i]*b[i]; }
+    return sum;
+}
+#endif
+
+static bool use_avx2_fma(){
+#ifdef CHESS_NATIVE_X86
+    static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+static inline void axpy(float a, const float* x, float* y, size_t n){
+#ifdef CHESS_NATIVE_X86
+    if(use_avx2_fma()){ axpy_avx2(a, x, y, n); return; }
+#endif
+    axpy_scalar(a, x, y, n);
+}
+
+static inline float dot(const float* a, const float* b, size_t n){
+#ifdef CHESS_NATIVE_X86
+    if(use_avx2_fma()){ return dot_avx2(a, b, n); }
+#endif
+    return dot_scalar(a, b, n);
+}
+
+static inline void axpy_i8(float a, const int8_t* q, float* y, size_t n){
+#ifdef CHESS_NATIVE_X86
+    if(use_avx2_fma()){ axpy_i8_avx2(a, q, y, n); return; }
+#endif
+    axpy_i8_scalar(a, q, y, n);
+}
+
+static inline float dot_i8(const int8_t* q, const float* b, size_t n){
+#ifdef CHESS_NATIVE_X86
+    if(use_avx2_fma()){ return dot_i8_avx2(q, b, n); }
+#endif
+    return dot_i8_scalar(q, b, n);
+}
+
+// (output columns per block: a block of one output row stays in L1)
+const size_t GEMM_BLOCK = 256;
+
+// y [rows,n_out] = x [rows,n_in] * w [n_in,n_out] + bias
+static void gemm(const float* x, size_t rows, size_t n_in,
+                 const float* w, size_t n_out, const float* bias, float* y){
+
+    for(size_t o0 = 0; o0 < n_out; o0 += GEMM_BLOCK){
+        size_t len = min(GEMM_BLOCK, n_out - o0);
+
+        for(size_t r = 0; r < rows; ++r){
+            memcpy(y + r*n_out + o0, bias + o0, len*sizeof(float));
+        }
+
+        // stream the weights once per block, accumulating into every row:
+        for(size_t i = 0; i < n_in; ++i){
+            const float* w_row = w + i*n_out + o0;
+            for(size_t r = 0; r < rows; ++r){
+                float xv = x[r*n_in + i];
+                if(xv != 0.0f){ axpy(xv, w_row, y + r*n_out + o0, len); }
+            }
+        }
+    }
+}
+
+// y [rows,n_out] = x [rows,n_in] * (w.q [n_in,n_out] * w.scale) + bias
+static void gemm_i8(const float* x, size_t rows, size_t n_in,
+                    const chessnet_int8_weights& w, size_t n_out, const float* bias, float* y){
+
+    for(size_t o0 = 0; o0 < n_out; o0 += GEMM_BLOCK){
+        size_t len = min(GEMM_BLOCK, n_out - o0);
+
+        for(size_t r = 0; r < rows; ++r){
+            fill(y + r*n_out + o0, y + r*n_out + o0 + len, 0.0f);
+        }
+
+        for(size_t i = 0; i < n_in; ++i){
+            const int8_t* q_row = w.q.data() + i*n_out + o0;
+            for(size_t r = 0; r < rows; ++r){
+                float xv = x[r*n_in + i];
+                if(xv != 0.0f){ axpy_i8(xv, q_row, y + r*n_out + o0, len); }
+            }
+        }
+
+        // apply the channel scales once per output:
+        for(size_t r = 0; r < rows; ++r){
+            float* y_block = y + r*n_out + o0;
+            for(size_t j = 0; j < len; ++j){
+                y_block[j] = y_block[j]*w.scale[o0 + j] + bias[o0 + j];
+            }
+        }
+    }
+}
+
+static void elu(float* x, size_t n){
+    for(size_t i = 0; i < n; ++i){
+        if(x[i] < 0.0f){ x[i] = expm1f(x[i]); }
+    }
+}
+
+// unrolls 3x3 patches, x [batch,size,size,c_in] -> cols [batch*out_size*out_size, 9*c_in]
+static void im2col_3x3(const float* x, size_t batch, unsigned int size, unsigned int c_in,
+                       bool same_padding, float* cols){
+
+    int pad = (same_padding)? 1 : 0;
+    unsigned int out_size = (same_padding)? size : size-2;
+
+    float* col = cols;
+    for(size_t b = 0; b < batch; ++b){
+        const float* xb = x + b*size*size*c_in;
+        for(unsigned int oy = 0; oy < out_size; ++oy){
+            for(unsigned int ox = 0; ox < out_size; ++ox){
+                for(int ky = 0; ky < 3; ++ky){
+                    for(int kx = 0; kx < 3; ++kx){
+                        int iy = static_cast<int>(oy) + ky - pad;
+                        int ix = static_cast<int>(ox) + kx - pad;
+                        if(0 <= iy && iy < static_cast<int>(size) && 0 <= ix && ix < static_cast<int>(size)){
+                            memcpy(col, xb + (iy*size + ix)*c_in, c_in*sizeof(float));
+                        } else {
+                            fill(col, col + c_in, 0.0f);
+                        }
+                        col += c_in;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* ---------------- ChessNativeNet ---------------- */
+
+ChessNativeNet::ChessNativeNet(){
+    this->n_conv_channels = 0;
+    this->fc1_size = 0;
+    this->fc2_size = 0;
+    this->policy_size = 0;
+    this->quantized = false;
+}
+
+static bool read_floats(FILE* file_in, vector<float>& v, size_t n){
+    v.resize(n);
+    return fread(v.data(), sizeof(float), n, file_in) == n;
+}
+
+static bool is_valid_size(uint32_t n){
+    return n > 0 && n <= CHESSNET_NATIVE_MAX_SIZE;
+}
+
+static size_t get_file_size(FILE* file_in){
+    long pos = ftell(file_in);
+    fseek(file_in, 0, SEEK_END);
+    long size = ftell(file_in);
+    fseek(file_in, pos, SEEK_SET);
+    return (size < 0)? 0 : static_cast<size_t>(size);
+}
+
+// size of a native weights file with the given (bounded) header sizes, in bytes:
+static size_t get_native_file_size(const chessnet_native_header& header){
+    size_t c = header.n_conv_channels;
+    size_t f1 = header.fc1_size, f2 = header.fc2_size, p = header.policy_size;
+    size_t n_floats = (9*BOARD_PLANES*c + c) + 3*(9*c*c + c)
+                    + (4*4*c*f1 + f1) + (f1*f2 + f2) + (f2*p + p) + (f2 + 1)
+                    + header.n_reference_samples*(BOARD_ENCODING_SIZE + p + 1);
+    return sizeof(header) + n_floats*sizeof(float);
+}
+
+bool ChessNativeNet::load(const string& path){
+
+    FILE* file_in = fopen(path.c_str(), "rb");
+    if(!file_in){
+        cerr << "Error: unable to open \"" + path + "\"." << endl;
+        return false;
+    }
+
+    // validate header (the sizes must match the size of the file, so a corrupt
+    // header is rejected here rather than failing to allocate the tensors):
+    chessnet_native_header header{};
+    bool ok = (fread(&header, sizeof(header), 1, file_in) == 1) &&
+              !memcmp(header.magic, CHESSNET_NATIVE_MAGIC, sizeof(header.magic)) &&
+              header.version == CHESSNET_NATIVE_VERSION;
+
+    // (the net is only used if it can be checked against the SavedModel)
+    if(ok && header.n_reference_samples == 0){
+        cerr << "Error: \"" + path + "\" has no reference outputs to check the net against"
+             << " (export it again with jupyter/export_native_weights.py)." << endl;
+        fclose(file_in);
+        return false;
+    }
+    ok = ok && is_valid_size(header.n_conv_channels) && is_valid_size(header.fc1_size) &&
+              is_valid_size(header.fc2_size) && is_valid_size(header.policy_size) &&
+              is_valid_size(header.n_reference_samples) &&
+              get_file_size(file_in) == get_native_file_size(header);
+
+    size_t c = header.n_conv_channels;
+    vector<float> pi_w;
+    for(unsigned int k = 0; ok && k < 4; ++k){
+        size_t c_in = (k == 0)? BOARD_PLANES : c;
+        ok = read_floats(file_in, conv_w[k], 9*c_in*c) && read_floats(file_in, conv_b[k], c);
+    }
+    ok = ok && read_floats(file_in, fc1_w, 4*4*c*header.fc1_size)
+            && read_floats(file_in, fc1_b, header.fc1_size)
+            && read_floats(file_in, fc2_w, static_cast<size_t>(header.fc1_size)*header.fc2_size)
+            && read_floats(file_in, fc2_b, header.fc2_size)
+            && read_floats(file_in, pi_w, static_cast<size_t>(header.fc2_size)*header.policy_size)
+            && read_floats(file_in, pi_b, header.policy_size)
+            && read_floats(file_in, v_w, header.fc2_size)
+            && read_floats(file_in, v_b, 1);
+
+    // reference outputs of the SavedModel:
+    size_t n_ref = header.n_reference_samples;
+    vector<float> ref_x, ref_pi, ref_v;
+    ok = ok && read_floats(file_in, ref_x, n_ref*BOARD_ENCODING_SIZE)
+            && read_floats(file_in, ref_pi, n_ref*header.policy_size)
+            && read_floats(file_in, ref_v, n_ref);
+
+    // ensure there is no trailing data:
+    ok = ok && (fgetc(file_in) == EOF);
+    fclose(file_in);
+
+    if(!ok){
+        cerr << "Error: \"" + path + "\" is not a valid native weights file." << endl;
+        return false;
+    }
+
+    // transpose the policy kernel, so each move's weights are contiguous:
+    pi_w_t.resize(pi_w.size());
+    for(size_t i = 0; i < header.fc2_size; ++i){
+        for(size_t j = 0; j < header.policy_size; ++j){
+            pi_w_t[j*header.fc2_size + i] = pi_w[i*header.policy_size + j];
+        }
+    }
+
+    n_conv_channels = header.n_conv_channels;
+    fc1_size = header.fc1_size;
+    fc2_size = header.fc2_size;
+    policy_size = header.policy_size;
+
+    // ensure the forward pass matches the SavedModel:
+    parity = check_parity(ref_x, ref_pi, ref_v);
+    if(parity.policy_error_max > CHESSNET_NATIVE_PARITY_TOLERANCE ||
+       parity.value_error_max > CHESSNET_NATIVE_PARITY_TOLERANCE){
+        cerr << "Error: the outputs of \"" + path + "\" differ from its reference outputs"
+             << " (max policy error " << parity.policy_error_max
+             << ", max value error " << parity.value_error_max
+             << ", tolerance " << CHESSNET_NATIVE_PARITY_TOLERANCE << ")." << endl;
+        policy_size = 0;
+        return false;
+    }
+    return true;
+}
+
+chessnet_parity_report ChessNativeNet::check_parity(const vector<float>& x, const vector<float>& pi,
+                                                    const vector<float>& v) const {
+    assert(!v.empty());
+    chessnet_parity_report report;
+    report.n_samples = v.size();
+
+    chessnet_native_workspace ws;
+    auto native_pi = vector<float>(pi.size());
+    auto native_v = vector<float>(v.size());
+    forward(x.data(), v.size(), native_pi.data(), native_v.data(), ws);
+
+    auto update_max = [](double& error_max, float a, float b){
+        double error = fabs(static_cast<double>(a) - b);
+        error_max = max(error_max, isnan(error)? HUGE_VAL : error);
+    };
+    for(size_t i = 0; i < pi.size(); ++i){
+        update_max(report.policy_error_max, native_pi[i], pi[i]);
+    }
+    for(size_t b = 0; b < v.size(); ++b){
+        update_max(report.value_error_max, native_v[b], v[b]);
+    }
+    return report;
+}
+
+void ChessNativeNet::forward_conv(const float* x, size_t batch, chessnet_native_workspace& ws) const {
+    assert(is_loaded());
+    size_t c = n_conv_channels;
+
+    // convolutional layers: (8x8, same) -> (8x8, same) -> (6x6, valid) -> (4x4, valid)
+    const unsigned int in_sizes[4] = { 8, 8, 8, 6 };
+    const bool same_padding[4] = { true, true, false, false };
+
+    ws.act_a.assign(x, x + batch*BOARD_ENCODING_SIZE);
+    for(unsigned int k = 0; k < 4; ++k){
+        unsigned int size = in_sizes[k];
+        unsigned int out_size = (same_padding[k])? size : size-2;
+        size_t c_in = (k == 0)? BOARD_PLANES : c;
+        size_t rows = batch*out_size*out_size;
+
+        ws.cols.resize(rows*9*c_in);
+        im2col_3x3(ws.act_a.data(), batch, size, c_in, same_padding[k], ws.cols.data());
+
+        ws.act_b.resize(rows*c);
+        gemm(ws.cols.data(), rows, 9*c_in, conv_w[k].data(), c, conv_b[k].data(), ws.act_b.data());
+        elu(ws.act_b.data(), ws.act_b.size());
+        swap(ws.act_a, ws.act_b);
+    }
+}
+
+void ChessNativeNet::forward_fc(unsigned int k, const float* in, size_t batch, float* out) const {
+    size_t n_in = (k == 0)? 4*4*n_conv_channels : fc1_size;
+    size_t n_out = (k == 0)? fc1_size : fc2_size;
+    const vector<float>& b = (k == 0)? fc1_b : fc2_b;
+
+    if(quantized){
+        gemm_i8(in, batch, n_in, (k == 0)? fc1_q : fc2_q, n_out, b.data(), out);
+    } else {
+        gemm(in, batch, n_in, ((k == 0)? fc1_w : fc2_w).data(), n_out, b.data(), out);
+    }
+    elu(out, batch*n_out);
+}
+
+void ChessNativeNet::forward_trunk(const float* x, size_t batch, float* h,
+                                   chessnet_native_workspace& ws) const {
+
+    // (the 4x4xC conv output is already flattened in NHWC order)
+    forward_conv(x, batch, ws);
+    ws.act_b.resize(batch*fc1_size);
+    forward_fc(0, ws.act_a.data(), batch, ws.act_b.data());
+    forward_fc(1, ws.act_b.data(), batch, h);
+}
+
+float ChessNativeNet::policy_logit(const float* h, unsigned int move_idx) const {
+    assert(move_idx < policy_size);
+    size_t offset = static_cast<size_t>(move_idx)*fc2_size;
+    if(quantized){
+        return pi_b[move_idx] + pi_q_t.scale[move_idx]*dot_i8(pi_q_t.q.data() + offset, h, fc2_size);
+    }
+    return pi_b[move_idx] + dot(pi_w_t.data() + offset, h, fc2_size);
+}
+
+float ChessNativeNet::value(const float* h) const {
+    return tanhf(v_b[0] + dot(v_w.data(), h, fc2_size));
+}
+
+void ChessNativeNet::forward(const float* x, size_t batch, float* pi, float* v,
+                             chessnet_native_workspace& ws) const {
+
+    auto h = vector<float>(batch*fc2_size);
+    forward_trunk(x, batch, h.data(), ws);
+
+    for(size_t b = 0; b < batch; ++b){
+        const float* hb = h.data() + b*fc2_size;
+        float* pib = pi + b*policy_size;
+
+        // policy softmax:
+        float max_logit = -1.0E+30f;
+        for(unsigned int j = 0; j < policy_size; ++j){
+            pib[j] = policy_logit(hb, j);
+            max_logit = max(max_logit, pib[j]);
+        }
+        float sum = 0.0f;
+        for(unsigned int j = 0; j < policy_size; ++j){
+            pib[j] = expf(pib[j] - max_logit);
+            sum += pib[j];
+        }
+        for(unsigned int j = 0; j < policy_size; ++j){ pib[j] /= sum; }
+
+        v[b] = value(hb);
+    }
+}
+
+// candidate clipping ranges (as a fraction of the largest channel weight):
+const float CLIP_RATIOS[] = { 1.0f, 0.9f, 0.8f, 0.7f, 0.6f, 0.5f };
+
+/*
+ * Quantizes a [n_in,n_out] kernel (or [n_out,n_in] if transposed) to int8, keeping
+ * the same layout. Each channel's scale is chosen from CLIP_RATIOS to minimize the
+ * squared error of the channel's outputs over the calibration inputs x [n,n_in].
+ */
+static chessnet_int8_weights quantize_kernel(const vector<float>& w, size_t n_in, size_t n_out,
+                                             bool transposed, const vector<float>& x, size_t n){
+    chessnet_int8_weights result;
+    result.q.resize(n_in*n_out);
+    result.scale.resize(n_out);
+
+    size_t stride = (transposed)? 1 : n_out;
+    auto channel = vector<float>(n_in);
+    auto q = vector<int8_t>(n_in);
+    auto w_err = vector<float>(n_in);
+
+    for(size_t j = 0; j < n_out; ++j){
+        size_t offset = (transposed)? j*n_in : j;
+        float w_max = 0.0f;
+        for(size_t i = 0; i < n_in; ++i){
+            channel[i] = w[offset + i*stride];
+            w_max = max(w_max, fabsf(channel[i]));
+        }
+
+        float best_scale = (w_max > 0.0f)? w_max / 127.0f : 1.0f;
+        double best_err = -1.0;
+        for(float clip : CLIP_RATIOS){
+            if(w_max == 0.0f){ break; }
+            float scale = clip * w_max / 127.0f;
+            for(size_t i = 0; i < n_in; ++i){
+                float qi = min(127.0f, max(-127.0f, roundf(channel[i] / scale)));
+                w_err[i] = channel[i] - qi*scale;
+            }
+
+            double err = 0.0;
+            for(size_t r = 0; r < n; ++r){
+                double e = dot(x.data() + r*n_in, w_err.data(), n_in);
+                err += e*e;
+            }
+            if(best_err < 0.0 || err < best_err){
+                best_err = err;
+                best_scale = scale;
+            }
+        }
+
+        result.scale[j] = best_scale;
+        for(size_t i = 0; i < n_in; ++i){
+            result.q[offset + i*stride] = static_cast<int8_t>(
+                min(127.0f, max(-127.0f, roundf(channel[i] / best_scale))));
+        }
+    }
+    return result;
+}
+
+void ChessNativeNet::quantize(const float* calib_x, size_t n_calib){
+    assert(is_loaded() && !quantized);
+    assert(n_calib > 0);
+
+    // collect the (float) inputs of each dense layer:
+    chessnet_native_workspace ws;
+    forward_conv(calib_x, n_calib, ws);
+    vector<float> x_fc1 = ws.act_a;
+    auto x_fc2 = vector<float>(n_calib*fc1_size);
+    forward_fc(0, x_fc1.data(), n_calib, x_fc2.data());
+    auto x_pi = vector<float>(n_calib*fc2_size);
+    forward_fc(1, x_fc2.data(), n_calib, x_pi.data());
+
+    fc1_q = quantize_kernel(fc1_w, 4*4*n_conv_channels, fc1_size, false, x_fc1, n_calib);
+    fc2_q = quantize_kernel(fc2_w, fc1_size, fc2_size, false, x_fc2, n_calib);
+    pi_q_t = quantize_kernel(pi_w_t, fc2_size, policy_size, true, x_pi, n_calib);
+
+    // release the float weights:
+    vector<float>().swap(fc1_w);
+    vector<float>().swap(fc2_w);
+    vector<float>().swap(pi_w_t);
+    quantized = true;
+}
+
+size_t ChessNativeNet::get_weights_size() const {
+    size_t n_floats = fc1_b.size() + fc2_b.size() + pi_b.size() + v_w.size() + v_b.size();
+    for(unsigned int k = 0; k < 4; ++k){
+        n_floats += conv_w[k].size() + conv_b[k].size();
+    }
+    n_floats += fc1_w.size() + fc2_w.size() + pi_w_t.size();
+    n_floats += fc1_q.scale.size() + fc2_q.scale.size() + pi_q_t.scale.size();
+
+    return n_floats*sizeof(float) + fc1_q.q.size() + fc2_q.q.size() + pi_q_t.q.size();
+}
+
+shared_ptr<const ChessNativeNet> load_chessnet_native(const string& path){
+    auto net = make_shared<ChessNativeNet>();
+    if(!net->load(path)){
+        return nullptr;
+    }
+    return net;
+}
+
+/* ---------------- ChessNativeEvaluator ---------------- */
+
+ChessNativeEvaluator::ChessNativeEvaluator(shared_ptr<const ChessNativeNet> net) : net(net){
+    assert(net && net->is_loaded());
+    this->x = vector<float>(BOARD_ENCODING_SIZE);
+    this->h = vector<float>(net->get_hidden_size());
+}
+
+double ChessNativeEvaluator::evaluate(GameState& gs, color player_to_move,
+                    vector<move_vector>& actions, vector<double>& prob_estimates){
+
+    // ensure actions is nonempty:
+    assert(actions.size() > 0);
+    util::monotonic_stopwatch timer;
+
+    encode_board(gs.board.data(), x.data());
+    double prepare_end = timer.elapsed_time<double, chrono::duration<double>>();
+
+    // compute the hidden layer, value, and the logits of the valid moves only:
+    net->forward_trunk(x.data(), 1, h.data(), ws);
+    double value = net->value(h.data());
+
+    prob_estimates.resize(actions.size());
+    double max_logit = -1.0E+30;
+    for(unsigned int i = 0; i < actions.size(); ++i){
+        move_vector a = actions[i];
+        unsigned int idx = (src_y(a)<<9) | (src_x(a)<<6) | (dest_y(a)<<3) | dest_x(a);
+        prob_estimates[i] = net->policy_logit(h.data(), idx);
+        max_logit = max(max_logit, prob_estimates[i]);
+    }
+    double run_end = timer.elapsed_time<double, chrono::duration<double>>();
+
+    // softmax over the valid moves:
+    double prob_sum = 0.0;
+    for(double &p : prob_estimates){
+        p = exp(p - max_logit);
+        prob_sum += p;
+    }
+    for(double &p : prob_estimates){ p /= prob_sum; }
+
+    double decode_end = timer.elapsed_time<double, chrono::duration<double>>();
+    stats->record_call(1, 0.0, prepare_end, run_end - prepare_end, decode_end - run_end);
+
+    return value;
+}
@@ -0,0 +1,172 @@
+#ifndef CHESS_NATIVE_NET_H
+#define CHESS_NATIVE_NET_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "chess_evaluator.h"
+
+using namespace std;
+
+/**
+ * Native weights file format (written by jupyter/export_native_weights.py):
+ *
+ *   [ chessnet_native_header ][ tensor 0 ][ tensor 1 ] ...
+ *
+ *  followed by the float32 tensors (host byte order), with batch
+ *  normalization already folded into the preceding layer:
+ *
+ *   conv k (k=1..4):  kernel [3][3][c_in][C], bias [C]   (c_in = 6 for k=1, else C)
+ *   fc1:              kernel [4*4*C][F1],     bias [F1]
+ *   fc2:              kernel [F1][F2],        bias [F2]
+ *   pi:               kernel [F2][P],         bias [P]
+ *   v:                kernel [F2][1],         bias [1]
+ *
+ *  where C = n_conv_channels, F1 = fc1_size, F2 = fc2_size, P = policy_size.
+ *
+ *  These are followed by N = n_reference_samples (at least one) input/output
+ *  pairs computed by the SavedModel, x [N][8][8][6], pi [N][P], v [N], which
+ *  the native forward pass must reproduce (within CHESSNET_NATIVE_PARITY_TOLERANCE)
+ *  for the file to load.
+ */
+const char CHESSNET_NATIVE_MAGIC[8] = { 'C','H','E','S','S','N','N','W' };
+const uint32_t CHESSNET_NATIVE_VERSION = 1;
+
+struct chessnet_native_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t n_conv_channels;
+    uint32_t fc1_size;
+    uint32_t fc2_size;
+    uint32_t policy_size;
+    uint32_t n_reference_samples;
+};
+
+// (bound on each size in the header, files with larger sizes are rejected)
+const uint32_t CHESSNET_NATIVE_MAX_SIZE = 1<<16;
+
+// max absolute error of the native outputs (pi and v) on the reference samples:
+const double CHESSNET_NATIVE_PARITY_TOLERANCE = 1.0E-4;
+
+struct chessnet_parity_report {
+    size_t n_samples = 0;
+    double policy_error_max = 0.0;
+    double value_error_max = 0.0;
+};
+
+// int8 weights with a float scale per output channel (w ~= scale[j] * q[.,j]):
+struct chessnet_int8_weights {
+    vector<int8_t> q;
+    vector<float> scale;
+};
+
+// scratch buffers for a forward pass (reused between calls):
+struct chessnet_native_workspace {
+    vector<float> cols;
+    vector<float> act_a;
+    vector<float> act_b;
+};
+
+/**
+ * CPU implementation of the forward pass of SimpleChessNet (inference mode):
+ *
+ *   4x (conv 3x3 + ELU) -> flatten -> 2x (dense + ELU) -> pi (softmax), v (tanh)
+ *
+ *  Convolutions are computed as im2col + matrix products, and all matrix
+ *  products use cache-blocked AVX2/FMA kernels when the CPU supports them
+ *  (with a scalar fallback). The policy head is stored transposed, so the
+ *  logits of individual moves can be computed as contiguous dot products.
+ *  A loaded net is read-only and may be shared between threads.
+ *
+ *  After quantize(), the dense layers and the policy head (nearly all of
+ *  the weights) are stored as int8 with a float scale per output channel,
+ *  and are accumulated in float. The scales are calibrated on a sample of
+ *  inputs: for each channel, the clipping range is chosen to minimize the
+ *  error of that channel's outputs over the sample.
+ */
+class ChessNativeNet {
+private:
+    unsigned int n_conv_channels;
+    unsigned int fc1_size;
+    unsigned int fc2_size;
+    unsigned int policy_size;
+
+    vector<float> conv_w[4], conv_b[4];
+    vector<float> fc1_w, fc1_b;
+    vector<float> fc2_w, fc2_b;
+    vector<float> pi_w_t, pi_b;     // (pi kernel transposed: [P][F2])
+    vector<float> v_w, v_b;
+
+    bool quantized;
+    chessnet_int8_weights fc1_q, fc2_q, pi_q_t;
+
+    chessnet_parity_report parity;
+
+    // compares the forward pass with the reference outputs pi [n,P], v [n] of x [n,8,8,6]:
+    chessnet_parity_report check_parity(const vector<float>& x, const vector<float>& pi,
+                                        const vector<float>& v) const;
+
+    // conv layers, x [batch,8,8,6] -> ws.act_a [batch,4*4*C]:
+    void forward_conv(const float* x, size_t batch, chessnet_native_workspace& ws) const;
+
+    // dense layers (with ELU), k = 0 (fc1) or 1 (fc2):
+    void forward_fc(unsigned int k, const float* in, size_t batch, float* out) const;
+
+public:
+    ChessNativeNet();
+
+    bool load(const string& path);
+
+    bool is_loaded() const { return policy_size > 0; }
+
+    unsigned int get_policy_size() const { return policy_size; }
+    unsigned int get_hidden_size() const { return fc2_size; }
+
+    // converts the dense weights to int8, calibrated on x [n_calib,8,8,6]:
+    void quantize(const float* calib_x, size_t n_calib);
+
+    bool is_quantized() const { return quantized; }
+
+    // agreement with the SavedModel on the reference samples of the weights file:
+    const chessnet_parity_report& get_parity_report() const { return parity; }
+
+    // size of the weights used in a forward pass (in bytes):
+    size_t get_weights_size() const;
+
+    // computes the shared hidden layer, x [batch,8,8,6] -> h [batch,F2]:
+    void forward_trunk(const float* x, size_t batch, float* h, chessnet_native_workspace& ws) const;
+
+    // heads for a single hidden vector:
+    float policy_logit(const float* h, unsigned int move_idx) const;
+    float value(const float* h) const;
+
+    // full forward pass, x [batch,8,8,6] -> pi [batch,P] (softmax), v [batch]:
+    void forward(const float* x, size_t batch, float* pi, float* v, chessnet_native_workspace& ws) const;
+};
+
+/**
+ * Evaluates positions with a ChessNativeNet (no TensorFlow needed).
+ *
+ *  Since the priors are renormalized over the valid moves, only the policy
+ *  logits of the valid moves are computed (softmax over those logits gives
+ *  the same priors as masking the full softmax output).
+ */
+class ChessNativeEvaluator : public ChessNetEvaluator {
+private:
+    shared_ptr<const ChessNativeNet> net;
+    chessnet_native_workspace ws;
+    vector<float> x;
+    vector<float> h;
+
+public:
+    ChessNativeEvaluator(shared_ptr<const ChessNativeNet> net);
+
+    double evaluate(GameState& gs, color player_to_move,
+                    vector<move_vector>& actions, vector<double>& prob_estimates);
+};
+
+shared_ptr<const ChessNativeNet> load_chessnet_native(const string& path);
+
+#endif /* CHESS_NATIVE_NET_H */
@@ -0,0 +1,95 @@
+#include <cmath>
+#include <cassert>
+#include <sstream>
+#include <algorithm>
+
+#include "chess_native_quantize.h"
+#include "chess_board_encoder.h"
+
+// (positions per forward pass when comparing nets)
+const size_t COMPARE_BATCH_SIZE = 64;
+
+string chessnet_agreement_report::to_json() const {
+    stringstream ss;
+    {
+        cereal::JSONOutputArchive archive_out(ss);
+        save(archive_out);
+    }
+    return ss.str();
+}
+
+void sample_chessnet_inputs(ChessNetDataSource& data, size_t n, bool midpoints, vector<float>& x){
+    size_t size = data.size();
+    assert(size > 0);
+
+    x.resize(n*BOARD_ENCODING_SIZE);
+    auto y_pi = vector<float>(64*64);
+    float y_v;
+    for(size_t i = 0; i < n; ++i){
+        size_t idx = (midpoints)? ((2*i + 1)*size) / (2*n) : (i*size) / n;
+        data.pack_item(idx % size, x.data() + i*BOARD_ENCODING_SIZE, y_pi.data(), &y_v);
+    }
+}
+
+shared_ptr<const ChessNativeNet> quantize_chessnet_native(const ChessNativeNet& net,
+                                    ChessNetDataSource& data, size_t n_calib){
+    vector<float> x;
+    sample_chessnet_inputs(data, n_calib, false, x);
+
+    auto quantized_net = make_shared<ChessNativeNet>(net);
+    quantized_net->quantize(x.data(), n_calib);
+    return quantized_net;
+}
+
+chessnet_agreement_report compare_chessnet_native(const ChessNativeNet& ref, const ChessNativeNet& test,
+                                    ChessNetDataSource& data, size_t n_samples){
+    assert(ref.get_policy_size() == test.get_policy_size());
+
+    chessnet_agreement_report report;
+    report.n_positions = n_samples;
+    report.ref_weights_size = ref.get_weights_size();
+    report.test_weights_size = test.get_weights_size();
+
+    vector<float> x;
+    sample_chessnet_inputs(data, n_samples, true, x);
+
+    size_t p = ref.get_policy_size();
+    auto ref_pi = vector<float>(COMPARE_BATCH_SIZE*p);
+    auto test_pi = vector<float>(COMPARE_BATCH_SIZE*p);
+    auto ref_v = vector<float>(COMPARE_BATCH_SIZE);
+    auto test_v = vector<float>(COMPARE_BATCH_SIZE);
+    chessnet_native_workspace ws;
+
+    size_t n_top1_agree = 0;
+    for(size_t b0 = 0; b0 < n_samples; b0 += COMPARE_BATCH_SIZE){
+        size_t batch = min(COMPARE_BATCH_SIZE, n_samples - b0);
+        const float* xb = x.data() + b0*BOARD_ENCODING_SIZE;
+        ref.forward(xb, batch, ref_pi.data(), ref_v.data(), ws);
+        test.forward(xb, batch, test_pi.data(), test_v.data(), ws);
+
+        for(size_t b = 0; b < batch; ++b){
+            const float* rp = ref_pi.data() + b*p;
+            const float* tp = test_pi.data() + b*p;
+            if(max_element(rp, rp + p) - rp == max_element(tp, tp + p) - tp){
+                ++n_top1_agree;
+            }
+
+            double tv = 0.0;
+            for(size_t j = 0; j < p; ++j){ tv += fabs(rp[j] - tp[j]); }
+            tv *= 0.5;
+            report.policy_tv_mean += tv;
+            report.policy_tv_max = max(report.policy_tv_max, tv);
+
+            double v_err = fabs(ref_v[b] - test_v[b]);
+            report.value_error_mean += v_err;
+            report.value_error_max = max(report.value_error_max, v_err);
+        }
+    }
+
+    if(n_samples > 0){
+        report.policy_top1_agreement = static_cast<double>(n_top1_agree) / n_samples;
+        report.policy_tv_mean /= n_samples;
+        report.value_error_mean /= n_samples;
+    }
+    return report;
+}
@@ -0,0 +1,57 @@
+#ifndef CHESS_NATIVE_QUANTIZE_H
+#define CHESS_NATIVE_QUANTIZE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cereal/cereal.hpp>
+#include <cereal/archives/json.hpp>
+
+#include "chess_native_net.h"
+#include "chess_dataset.h"
+
+using namespace std;
+
+/**
+ * Agreement of a (quantized) native net with a reference net,
+ * measured over a sample of dataset positions.
+ */
+struct chessnet_agreement_report {
+    size_t n_positions = 0;
+    double policy_top1_agreement = 0.0;     // (fraction of positions with the same best move)
+    double policy_tv_mean = 0.0;            // (total variation distance between policies)
+    double policy_tv_max = 0.0;
+    double value_error_mean = 0.0;          // (absolute difference of values)
+    double value_error_max = 0.0;
+    size_t ref_weights_size = 0;
+    size_t test_weights_size = 0;
+
+    template<class Archive>
+    void save(Archive& ar) const {
+        ar(cereal::make_nvp("n_positions", n_positions),
+           cereal::make_nvp("policy_top1_agreement", policy_top1_agreement),
+           cereal::make_nvp("policy_tv_mean", policy_tv_mean),
+           cereal::make_nvp("policy_tv_max", policy_tv_max),
+           cereal::make_nvp("value_error_mean", value_error_mean),
+           cereal::make_nvp("value_error_max", value_error_max),
+           cereal::make_nvp("ref_weights_size", ref_weights_size),
+           cereal::make_nvp("test_weights_size", test_weights_size));
+    }
+
+    string to_json() const;
+};
+
+// packs n inputs sampled at even intervals from data into x [n,8,8,6]
+// (at the midpoints of the intervals, if midpoints is set):
+void sample_chessnet_inputs(ChessNetDataSource& data, size_t n, bool midpoints, vector<float>& x);
+
+// returns an int8 copy of net, calibrated on n_calib positions sampled from data:
+shared_ptr<const ChessNativeNet> quantize_chessnet_native(const ChessNativeNet& net,
+                                    ChessNetDataSource& data, size_t n_calib = 256);
+
+// compares the outputs of two nets, on positions in between the calibration samples:
+chessnet_agreement_report compare_chessnet_native(const ChessNativeNet& ref, const ChessNativeNet& test,
+                                    ChessNetDataSource& data, size_t n_samples = 256);
+
+#endif /* CHESS_NATIVE_QUANTIZE_H */
@@ -0,0 +1,118 @@
+#include "chess_pgn_lexer.h"
+
+inline bool is_pgn_space(char ch){
+    return (ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t' || ch == '\f' || ch == '\v');
+}
+
+inline bool is_pgn_delimiter(char ch){
+    return (is_pgn_space(ch) || ch == '{' || ch == '}' || ch == '(' || ch == ')'
+         || ch == '[' || ch == ']' || ch == ';' || ch == '$');
+}
+
+void PGNLexer::skip_whitespace(){
+    while(pos < end && is_pgn_space(*pos)){ ++pos; }
+}
+
+void PGNLexer::skip_to_eol(){
+    while(pos < end && *pos != '\n'){ ++pos; }
+}
+
+bool PGNLexer::skip_past(char close_ch){
+    while(pos < end && *pos != close_ch){ ++pos; }
+    if(pos >= end){ return false; }
+    ++pos;
+    return true;
+}
+
+bool PGNLexer::skip_variation(){
+    // skip (possibly nested) variations, along with any comments inside them:
+    int depth = 0;
+    while(pos < end){
+        char ch = *pos;
+        if(ch == '{'){
+            if(!skip_past('}')){ return false; }
+            continue;
+        } else if(ch == ';'){
+            skip_to_eol();
+            continue;
+        } else if(ch == '('){
+            ++depth;
+        } else if(ch == ')'){
+            --depth;
+            if(depth <= 0){
+                ++pos;
+                return true;
+            }
+        }
+        ++pos;
+    }
+    return false;
+}
+
+bool PGNLexer::next(pgn_token& token){
+    skip_whitespace();
+    if(pos >= end){
+        token.type = PGN_END;
+        token.text = string_view();
+        return false;
+    }
+
+    const char* start = pos;
+    char ch = *pos;
+
+    if(ch == '['){
+        // tag pair (brackets inside quoted values are ignored):
+        bool quoted = false;
+        ++pos;
+        while(pos < end && (quoted || *pos != ']')){
+            if(*pos == '\\' && quoted && pos+1 < end){ ++pos; }
+            else if(*pos == '"'){ quoted = !quoted; }
+            ++pos;
+        }
+        if(pos < end){ ++pos; }
+        token.type = PGN_TAG;
+
+    } else if(ch == '{'){
+        skip_past('}');
+        token.type = PGN_COMMENT;
+
+    } else if(ch == ';' || (ch == '%' && (pos == begin || pos[-1] == '\n'))){
+        skip_to_eol();
+        token.type = PGN_COMMENT;
+
+    } else if(ch == '('){
+        skip_variation();
+        token.type = PGN_COMMENT;
+
+    } else if(ch == '$'){
+        ++pos;
+        while(pos < end && '0' <= *pos && *pos <= '9'){ ++pos; }
+        token.type = PGN_NAG;
+
+    } else if(ch == ')' || ch == ']' || ch == '}'){
+        // stray closing delimiter:
+        ++pos;
+        token.type = PGN_COMMENT;
+
+    } else {
+        // read a symbol:
+        while(pos < end && !is_pgn_delimiter(*pos)){ ++pos; }
+        string_view sym(start, pos - start);
+
+        if(sym == "1-0" || sym == "0-1" || sym == "1/2-1/2" || sym == "*"){
+            token.type = PGN_RESULT;
+        } else if('0' <= ch && ch <= '9' && sym.find('.') != string_view::npos){
+            // move number (a move may directly follow it, e.g. "1.e4"):
+            size_t n = 0;
+            while(n < sym.size() && '0' <= sym[n] && sym[n] <= '9'){ ++n; }
+            while(n < sym.size() && sym[n] == '.'){ ++n; }
+            pos = start + n;
+            token.type = PGN_MOVE_NUMBER;
+        } else {
+            token.type = PGN_MOVE;
+        }
+    }
+
+    token.text = string_view(start, pos - start);
+    return true;
+}
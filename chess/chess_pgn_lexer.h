@@ -0,0 +1,51 @@
+#ifndef CHESS_PGN_LEXER_H
+#define CHESS_PGN_LEXER_H
+
+#include <cstddef>
+#include <string_view>
+
+using namespace std;
+
+enum pgn_token_type {
+    PGN_TAG,            // [Name "Value"]
+    PGN_COMMENT,        // {...}, ; ... <eol>, % ... <eol>, or a (...) variation
+    PGN_NAG,            // $1
+    PGN_MOVE_NUMBER,    // 12. or 12...
+    PGN_MOVE,           // e4, Nbxd7+, O-O, e8=Q#, ...
+    PGN_RESULT,         // 1-0, 0-1, 1/2-1/2, *
+    PGN_END
+};
+
+struct pgn_token {
+    pgn_token_type type;
+    string_view text;
+};
+
+/**
+ * Zero-copy PGN tokenizer over an in-memory (e.g. mmap'ed) buffer.
+ *
+ *  Tokens are views into the buffer, so the buffer must outlive them.
+ *  No memory is allocated while tokenizing.
+ */
+class PGNLexer {
+private:
+    const char* begin;
+    const char* end;
+    const char* pos;
+
+    void skip_whitespace();
+    void skip_to_eol();
+    bool skip_past(char close_ch);
+    bool skip_variation();
+
+public:
+    PGNLexer(const char* data, size_t size, size_t offset = 0) :
+        begin(data), end(data + size), pos(data + offset) {}
+
+    bool next(pgn_token& token);
+
+    size_t get_offset() const { return pos - begin; }
+    void seek(size_t offset){ pos = begin + offset; }
+};
+
+#endif /* CHESS_PGN_LEXER_H */
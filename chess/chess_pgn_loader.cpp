@@ -1,55 +1,120 @@
 #include <fstream>
 #include <string>
-#include <sstream>
 #include <iostream>
 #include <array>
+#include <thread>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include <sys/stat.h>
 
 #include "chess_pgn_loader.h"
 #include "chess_game.h"
 #include "chess_game_state.h"
-#include "util/string_ops.h"
 
-PGNLoader::PGNLoader(string path){
+const char PGN_INDEX_MAGIC[8] = { 'P','G','N','I','N','D','E','X' };
+
+PGNLoader::PGNLoader(string path, bool use_index_cache){
     this->path = path;
+    this->index_path = path + ".idx";
     this->size = 0;
-    pgn_in = ifstream();
-    pgn_in.open(this->path);
-    assert(pgn_in);
-    
 
-    // determine the size of the file:
-    if(pgn_in){
-        while(seek_next_game()){ ++(this->size); }
+    if(!file.open(path)){
+        cerr << "Error: unable to open \"" + path + "\"." << endl;
+        return;
+    }
+    file.advise_sequential();
+
+    // load the game index (or build and cache it):
+    if(!(use_index_cache && load_index())){
+        build_index();
+        if(use_index_cache){
+            save_index();
+        }
     }
+    this->size = game_offsets.size();
 }
 
-bool PGNLoader::seek_next_game(){
-    // jump to first index:
-    string token;
-    while(pgn_in >> token){
-        assert(token.size() > 0);
-
-        // handle game metadata and comments:
-        if(token[0] == '['){
-            while(pgn_in && token[token.size()-1] != ']'){ pgn_in >> token; }
-        } else if(token[0] == '{'){
-            while(pgn_in && token[token.size()-1] != '}'){ pgn_in >> token; }
-        } else if(token[0] == ';'){
-            getline(pgn_in, token);
-        } else {
-            // identify first line of game:
-            token = util::strip(token);
-            if(token == "1."){ break; }
+void PGNLoader::build_index(){
+    PGNLexer lexer(file.data(), file.size());
+    pgn_token token;
+
+    // record the offset of the first move of each game:
+    game_offsets.clear();
+    while(lexer.next(token)){
+        if(token.type == PGN_MOVE_NUMBER && token.text == "1."){
+            game_offsets.push_back(lexer.get_offset());
         }
     }
+}
+
+bool PGNLoader::load_index(){
+    struct stat pgn_stat;
+    if(stat(path.c_str(), &pgn_stat) != 0){
+        return false;
+    }
 
-    return bool(pgn_in);
+    ifstream index_in(index_path, ios::binary);
+    if(!index_in){
+        return false;
+    }
+
+    // validate that the index matches the current PGN file:
+    char magic[8];
+    uint64_t file_size, n_games;
+    int64_t file_mtime;
+    index_in.read(magic, sizeof(magic));
+    index_in.read(reinterpret_cast<char*>(&file_size), sizeof(file_size));
+    index_in.read(reinterpret_cast<char*>(&file_mtime), sizeof(file_mtime));
+    index_in.read(reinterpret_cast<char*>(&n_games), sizeof(n_games));
+    if(!index_in || memcmp(magic, PGN_INDEX_MAGIC, sizeof(magic)) ||
+       file_size != static_cast<uint64_t>(pgn_stat.st_size) ||
+       file_mtime != static_cast<int64_t>(pgn_stat.st_mtime)){
+        return false;
+    }
+
+    auto offsets = vector<uint64_t>(n_games);
+    index_in.read(reinterpret_cast<char*>(offsets.data()), n_games*sizeof(uint64_t));
+    if(!index_in){
+        return false;
+    }
+
+    game_offsets.assign(offsets.begin(), offsets.end());
+    return true;
+}
+
+bool PGNLoader::save_index(){
+    struct stat pgn_stat;
+    if(stat(path.c_str(), &pgn_stat) != 0){
+        return false;
+    }
+
+    ofstream index_out(index_path, ios::binary);
+    if(!index_out){
+        cerr << "Warning: unable to write PGN index \"" + index_path + "\"." << endl;
+        return false;
+    }
+
+    uint64_t file_size = pgn_stat.st_size;
+    int64_t file_mtime = pgn_stat.st_mtime;
+    uint64_t n_games = game_offsets.size();
+    auto offsets = vector<uint64_t>(game_offsets.begin(), game_offsets.end());
+
+    index_out.write(PGN_INDEX_MAGIC, sizeof(PGN_INDEX_MAGIC));
+    index_out.write(reinterpret_cast<const char*>(&file_size), sizeof(file_size));
+    index_out.write(reinterpret_cast<const char*>(&file_mtime), sizeof(file_mtime));
+    index_out.write(reinterpret_cast<const char*>(&n_games), sizeof(n_games));
+    index_out.write(reinterpret_cast<const char*>(offsets.data()), n_games*sizeof(uint64_t));
+
+    return bool(index_out);
 }
 
 
 unsigned int PGNLoader::get_training_data(
                             chessnet_dataset& dataset, 
-                            int start_idx, int end_idx){
+                            int start_idx, int end_idx,
+                            unsigned int n_threads){
 
     // perform index sanity check:
     if(start_idx < 0){ start_idx += this->size; }
@@ -61,73 +126,90 @@ unsigned int PGNLoader::get_training_data(
         return 0;
     }
 
-    // find game at start index:
-    pgn_in.clear();
-    pgn_in.seekg(0, ios::beg);
-    for(int i = 0; i <= start_idx; ++i){
-        seek_next_game(); 
+    // split the game range evenly between worker threads:
+    if(n_threads == 0){
+        n_threads = max(1u, thread::hardware_concurrency());
+    }
+    int n_games = end_idx - start_idx;
+    n_threads = max(1u, min(n_threads, static_cast<unsigned int>(n_games)));
+
+    auto worker_data = vector<chessnet_dataset>(n_threads);
+    auto worker_n_parsed = vector<unsigned int>(n_threads, 0);
+    auto workers = vector<thread>();
+
+    for(unsigned int t = 0; t < n_threads; ++t){
+        int worker_start = start_idx + (n_games*t)/n_threads;
+        int worker_end = start_idx + (n_games*(t+1))/n_threads;
+        workers.emplace_back([this, t, worker_start, worker_end, &worker_data, &worker_n_parsed](){
+            worker_n_parsed[t] = parse_games(worker_start, worker_end, worker_data[t]);
+        });
     }
 
-    // parse games:
+    // merge worker results (in game order):
     unsigned int n_games_parsed = 0;
-    for(int i = start_idx; i < end_idx && pgn_in; ++i){
+    for(unsigned int t = 0; t < n_threads; ++t){
+        workers[t].join();
+        n_games_parsed += worker_n_parsed[t];
+        dataset.insert(dataset.end(), worker_data[t].begin(), worker_data[t].end());
+        worker_data[t].clear();
+    }
 
-        vector<string> w_moves, b_moves;
+    return n_games_parsed;
+}
+
+unsigned int PGNLoader::parse_games(int start_idx, int end_idx, chessnet_dataset& dataset){
+    
+    // (each worker tokenizes the shared mapping independently):
+    PGNLexer lexer(file.data(), file.size());
+    unsigned int n_games_parsed = 0;
+    
+    vector<string_view> w_moves, b_moves;
+    for(int i = start_idx; i < end_idx; ++i){
+
+        // seek directly to the first move of the game:
+        lexer.seek(game_offsets[i]);
+
+        w_moves.clear();
+        b_moves.clear();
         double outcome = 0.0;
-        if(parse_game_moves(w_moves, b_moves, outcome) &&
+        if(parse_game_moves(lexer, w_moves, b_moves, outcome) &&
            simulate_game(w_moves, b_moves, outcome, dataset)){
             ++n_games_parsed;
         }
-        seek_next_game();
     }
 
     return n_games_parsed;
 }
 
-bool PGNLoader::parse_game_moves(vector<string>& w_moves,
-                          vector<string>& b_moves,
+bool PGNLoader::parse_game_moves(PGNLexer& lexer,
+                          vector<string_view>& w_moves,
+                          vector<string_view>& b_moves,
                           double& outcome){
-    string token;
+    pgn_token token;
     color turn = WHITE;
-    while(pgn_in >> token){
-
-        token = util::strip(token);
-        // ignore inline comments (if any)
-        if(token[0] == '['){
-            while(pgn_in && token[token.size()-1] != ']'){ pgn_in >> token; }
-            continue;
-        } else if(token[0] == '{'){
-              while(pgn_in && token[token.size()-1] != '}'){ pgn_in >> token; }
-              continue;
-        } else if(token[0] == ';'){
-            getline(pgn_in, token);
-            continue;
-        } else if(token[token.size()-1] == '.'){
-            continue;
-        }
+    while(lexer.next(token)){
 
         // check for end of game:
-        if(token == "0-1"){ 
-            outcome = -1.0; 
-            return bool(pgn_in); 
-        } else if(token == "1/2-1/2" || token == "*"){ 
-            outcome = 0.0; 
-            return bool(pgn_in); 
-        } else if(token == "1-0"){ 
-            outcome = 1.0; 
-            return bool(pgn_in);
+        if(token.type == PGN_RESULT){
+            if(token.text == "1-0"){ outcome = 1.0; }
+            else if(token.text == "0-1"){ outcome = -1.0; }
+            else { outcome = 0.0; }
+            return true;
         }
-        
+
+        // ignore tags, comments, NAGs and move numbers:
+        if(token.type != PGN_MOVE){ continue; }
+
         // parse game move:
         if(turn == WHITE){
-            w_moves.push_back(token);
+            w_moves.push_back(token.text);
         } else {
-            b_moves.push_back(token);
+            b_moves.push_back(token.text);
         }
         turn = !turn;
     }
 
-    return bool(pgn_in);
+    return false;
 }
 
 void PGNLoader::add_move_data(GameState& gs, move_vector m, 
@@ -142,8 +224,8 @@ void PGNLoader::add_move_data(GameState& gs, move_vector m,
     dataset.emplace_back(gs.board, probs, outcome);
 }
 
-bool PGNLoader::simulate_game(vector<string>& w_moves,
-                    vector<string>& b_moves,
+bool PGNLoader::simulate_game(vector<string_view>& w_moves,
+                    vector<string_view>& b_moves,
                     double& outcome,
                     chessnet_dataset& dataset){
 
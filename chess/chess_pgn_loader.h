@@ -2,36 +2,58 @@
 #define CHESS_PGN_LOADER_H
 
 #include <fstream>
+#include <vector>
+#include <string_view>
 
 #include "chess_game.h"
 #include "chess_game_state.h"
-
+#include "chess_pgn_lexer.h"
+#include "util/mmap_file.h"
+
+/**
+ * Loads training data from a PGN file of expert games.
+ *
+ *  The file is memory-mapped and tokenized in place (see PGNLexer). On
+ *  construction, the loader indexes the byte offset of the first move of
+ *  every game in the file. The index is cached in a sidecar file
+ *  ("<path>.idx") and reused as long as the PGN file is unchanged, so games
+ *  can be seeked to directly and disjoint game ranges can be parsed and
+ *  simulated by several worker threads in parallel.
+ */
 class PGNLoader {
 private:
     string path;
+    string index_path;
     unsigned int size;
-    ifstream pgn_in;
+    util::mmap_file file;
+    vector<size_t> game_offsets;
 
-    bool seek_next_game();
-    bool parse_game_moves(vector<string>& w_moves,
-                          vector<string>& b_moves,
+    bool parse_game_moves(PGNLexer& lexer,
+                          vector<string_view>& w_moves,
+                          vector<string_view>& b_moves,
                           double& outcome);
 
-    bool simulate_game(vector<string>& w_moves,
-                       vector<string>& b_moves,
+    bool simulate_game(vector<string_view>& w_moves,
+                       vector<string_view>& b_moves,
                        double& outcome,
                        chessnet_dataset& dataset);
 
     void add_move_data(GameState& gs, move_vector m, 
                        double outcome, 
                        chessnet_dataset& dataset);
+
+    void build_index();
+    bool load_index();
+    bool save_index();
+
+    unsigned int parse_games(int start_idx, int end_idx, chessnet_dataset& dataset);
 public:
-    PGNLoader(string path);
-    ~PGNLoader(){ pgn_in.close(); }
+    PGNLoader(string path, bool use_index_cache = true);
 
     unsigned int get_size(){ return size; };
 
     unsigned int get_training_data(chessnet_dataset& dataset, 
-                            int start_idx=0, int end_idx=0);
+                            int start_idx=0, int end_idx=0,
+                            unsigned int n_threads=0);
 };
-#endif /* CHESS_PGN_LOADER_H */
\ No newline at end of file
+#endif /* CHESS_PGN_LOADER_H */
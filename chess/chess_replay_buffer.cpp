@@ -0,0 +1,171 @@
+#include <cmath>
+#include <cassert>
+#include <cstring>
+
+#include "chess_replay_buffer.h"
+
+ChessNetReplayBuffer::ChessNetReplayBuffer(size_t capacity){
+    assert(capacity > 0);
+    this->capacity = capacity;
+    this->head = 0;
+    this->n_items = 0;
+    this->n_ingested = 0;
+    this->n_merged = 0;
+}
+
+size_t ChessNetReplayBuffer::hash_board(const array<piece,64>& board){
+    size_t h = 0;
+    for (auto p : board){
+        h ^= std::hash<int>{}(p)  + 0x9e3779b9 + (h << 6) + (h >> 2);
+    }
+    return h;
+}
+
+void ChessNetReplayBuffer::swap_slots(size_t a, size_t b){
+    if(a == b){ return; }
+    swap(slots[a], slots[b]);
+    swap(slot_keys[a], slot_keys[b]);
+    swap(slot_counts[a], slot_counts[b]);
+
+    // (a key may map to another slot if two boards have the same hash, and both
+    // slots may have the same key, so both checks are made before updating)
+    auto a_ptr = key_slots.find(slot_keys[a]);
+    auto b_ptr = key_slots.find(slot_keys[b]);
+    bool moved_to_a = (a_ptr != key_slots.end() && a_ptr->second == b);
+    bool moved_to_b = (b_ptr != key_slots.end() && b_ptr->second == a);
+    if(moved_to_a){ a_ptr->second = a; }
+    if(moved_to_b){ b_ptr->second = b; }
+}
+
+void ChessNetReplayBuffer::add(chessnet_dataset& data){
+    lock_guard<mutex> lock(buffer_mutex);
+    for(auto& [elem_board, elem_probs, elem_value] : data){
+        add_position(elem_board, elem_probs, elem_value);
+    }
+}
+
+void ChessNetReplayBuffer::add_position(const array<piece,64>& board,
+                                        const array<double,64*64>& probs, double value){
+    ++n_ingested;
+    size_t key = hash_board(board);
+
+    // merge into an existing entry if the position was already seen:
+    auto key_ptr = key_slots.find(key);
+    if(key_ptr != key_slots.end()){
+        size_t slot = key_ptr->second;
+        chessnet_record& r = slots[slot];
+
+        bool same_board = true;
+        for(unsigned int k = 0; k < 64 && same_board; ++k){
+            same_board = (r.board[k] == static_cast<int8_t>(board[k]));
+        }
+
+        if(same_board){
+            float count = static_cast<float>(slot_counts[slot]);
+            for(unsigned int k = 0; k < 64*64; ++k){
+                float p = (isnan(probs[k]))? 0.0f : static_cast<float>(probs[k]);
+                r.probs[k] = (count*r.probs[k] + p) / (count + 1.0f);
+            }
+            r.value = (count*r.value + static_cast<float>(value)) / (count + 1.0f);
+            ++slot_counts[slot];
+            ++n_merged;
+
+            // the position was just seen, so move it to the newest place in the
+            // window: if the buffer is full, it takes the place of the oldest entry
+            // (at the head), which is moved to its slot. Otherwise it trades
+            // places with the newest entry:
+            if(n_items == capacity){
+                swap_slots(slot, head);
+                head = (head + 1) % capacity;
+            } else {
+                swap_slots(slot, (head + capacity - 1) % capacity);
+            }
+            return;
+        }
+    }
+
+    // evict the oldest entry (if the buffer is full):
+    size_t slot = head;
+    if(n_items < capacity){
+        slots.emplace_back();
+        slot_keys.push_back(0);
+        slot_counts.push_back(0);
+        ++n_items;
+    } else {
+        auto old_ptr = key_slots.find(slot_keys[slot]);
+        if(old_ptr != key_slots.end() && old_ptr->second == slot){
+            key_slots.erase(old_ptr);
+        }
+    }
+    head = (head + 1) % capacity;
+
+    // write new entry:
+    chessnet_record& r = slots[slot];
+    for(unsigned int k = 0; k < 64; ++k){ r.board[k] = static_cast<int8_t>(board[k]); }
+    for(unsigned int k = 0; k < 64*64; ++k){
+        r.probs[k] = (isnan(probs[k]))? 0.0f : static_cast<float>(probs[k]);
+    }
+    r.value = static_cast<float>(value);
+
+    slot_keys[slot] = key;
+    slot_counts[slot] = 1;
+    key_slots[key] = slot;
+}
+
+void ChessNetReplayBuffer::clear(){
+    lock_guard<mutex> lock(buffer_mutex);
+    slots.clear();
+    slot_keys.clear();
+    slot_counts.clear();
+    key_slots.clear();
+    head = 0;
+    n_items = 0;
+}
+
+size_t ChessNetReplayBuffer::size(){
+    lock_guard<mutex> lock(buffer_mutex);
+    return n_items;
+}
+
+void ChessNetReplayBuffer::sample_uniform(unsigned int n, default_random_engine& rng,
+                                          vector<unsigned int>& idxs){
+    lock_guard<mutex> lock(buffer_mutex);
+    idxs.clear();
+    if(n_items == 0){ return; }
+
+    uniform_int_distribution<size_t> random_slot(0, n_items-1);
+    for(unsigned int i = 0; i < n; ++i){
+        idxs.push_back(random_slot(rng));
+    }
+}
+
+void ChessNetReplayBuffer::sample_recent(unsigned int n, double recency_half_life,
+                                         default_random_engine& rng, vector<unsigned int>& idxs){
+    assert(recency_half_life > 0.0);
+
+    lock_guard<mutex> lock(buffer_mutex);
+    idxs.clear();
+    if(n_items == 0){ return; }
+
+    // sample entry ages from a geometric distribution truncated to the buffer size
+    // (i.e. P(age) ~ decay^age, with decay^recency_half_life = 1/2):
+    double log_decay = -log(2.0) / recency_half_life;
+    double tail_mass = 1.0 - exp(log_decay*static_cast<double>(n_items));
+    uniform_real_distribution<double> random_prob(0.0, 1.0);
+
+    for(unsigned int i = 0; i < n; ++i){
+        double u = random_prob(rng);
+        size_t age = static_cast<size_t>(log(1.0 - u*tail_mass) / log_decay);
+        if(age >= n_items){ age = n_items-1; }
+
+        // the newest entry is located just before the head:
+        idxs.push_back((head + capacity - 1 - age) % capacity);
+    }
+}
+
+void ChessNetReplayBuffer::pack_item(size_t idx, float* x, float* y_pi, float* y_v,
+                                     chessnet_symmetry s){
+    lock_guard<mutex> lock(buffer_mutex);
+    assert(idx < n_items);
+    pack_chessnet_record(slots[idx], x, y_pi, y_v, s);
+}
@@ -0,0 +1,67 @@
+#ifndef CHESS_REPLAY_BUFFER_H
+#define CHESS_REPLAY_BUFFER_H
+
+#include <vector>
+#include <random>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+
+#include "chess_dataset.h"
+
+/**
+ * Sliding window of the most recent training positions.
+ *
+ *  Positions are ingested continuously (e.g. after each self-play game) into
+ *  a ring buffer of fixed capacity; once the buffer is full, the oldest
+ *  positions are overwritten. Identical positions are deduplicated: the
+ *  policy and value of a repeated position are averaged into the existing entry,
+ *  which is then treated as the newest entry (for eviction and recency weights).
+ *
+ *  Minibatch indices are sampled either uniformly or weighted by recency
+ *  (with weights halving every recency_half_life positions). Ingestion and
+ *  sampling/packing are safe to call from different threads, so self-play
+ *  and training can run as a continuous pipeline.
+ */
+class ChessNetReplayBuffer : public ChessNetDataSource {
+private:
+    size_t capacity;
+    vector<chessnet_record> slots;
+    vector<size_t> slot_keys;
+    vector<unsigned int> slot_counts;
+    unordered_map<size_t,size_t> key_slots;
+
+    size_t head;
+    size_t n_items;
+    atomic<unsigned long long> n_ingested;    // (read without the lock)
+    atomic<unsigned long long> n_merged;
+
+    mutex buffer_mutex;
+
+    size_t hash_board(const array<piece,64>& board);
+    void swap_slots(size_t a, size_t b);
+    void add_position(const array<piece,64>& board, const array<double,64*64>& probs, double value);
+
+public:
+    ChessNetReplayBuffer(size_t capacity);
+
+    void add(chessnet_dataset& data);
+
+    void clear();
+
+    size_t size();
+
+    size_t get_capacity(){ return capacity; }
+    unsigned long long get_n_ingested(){ return n_ingested.load(); }
+    unsigned long long get_n_merged(){ return n_merged.load(); }
+
+    void sample_uniform(unsigned int n, default_random_engine& rng, vector<unsigned int>& idxs);
+
+    void sample_recent(unsigned int n, double recency_half_life,
+                       default_random_engine& rng, vector<unsigned int>& idxs);
+
+    void pack_item(size_t idx, float* x, float* y_pi, float* y_v,
+                   chessnet_symmetry s = SYM_IDENTITY);
+};
+
+#endif /* CHESS_REPLAY_BUFFER_H */
@@ -0,0 +1,86 @@
+#include <cstdint>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "chess_session_config.h"
+#include "cppflow/defer.h"
+
+// protobuf wire format helpers:
+static void write_varint(string& out, uint64_t value){
+    while(value >= 0x80){
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+static void write_varint_field(string& out, unsigned int field, uint64_t value){
+    write_varint(out, (field << 3) | 0);
+    write_varint(out, value);
+}
+
+static void write_bytes_field(string& out, unsigned int field, const string& bytes){
+    write_varint(out, (field << 3) | 2);
+    write_varint(out, bytes.size());
+    out += bytes;
+}
+
+string serialize_session_config(const chessnet_session_config& config){
+
+    // (field numbers are those of tensorflow/core/protobuf/config.proto)
+    const unsigned int INTRA_OP_PARALLELISM_THREADS = 2;
+    const unsigned int INTER_OP_PARALLELISM_THREADS = 5;
+    const unsigned int USE_PER_SESSION_THREADS = 9;
+    const unsigned int SESSION_INTER_OP_THREAD_POOL = 12;
+    const unsigned int POOL_NUM_THREADS = 1;
+    const unsigned int POOL_GLOBAL_NAME = 2;
+
+    string proto;
+    if(config.intra_op_threads > 0){
+        write_varint_field(proto, INTRA_OP_PARALLELISM_THREADS, config.intra_op_threads);
+    }
+    if(config.inter_op_threads > 0){
+        write_varint_field(proto, INTER_OP_PARALLELISM_THREADS, config.inter_op_threads);
+    }
+
+    if(!config.inter_op_pool_name.empty()){
+        // sessions that name the same pool share its threads:
+        string pool;
+        if(config.inter_op_threads > 0){
+            write_varint_field(pool, POOL_NUM_THREADS, config.inter_op_threads);
+        }
+        write_bytes_field(pool, POOL_GLOBAL_NAME, config.inter_op_pool_name);
+        write_bytes_field(proto, SESSION_INTER_OP_THREAD_POOL, pool);
+    } else if(config.isolate_pools){
+        write_varint_field(proto, USE_PER_SESSION_THREADS, 1);
+    }
+
+    return proto;
+}
+
+cppflow::model load_chessnet_model(const string& model_path,
+                        const chessnet_session_config& config){
+
+    // threads inherit the affinity of the thread that creates them, so pin the
+    // calling thread while the session (and its thread pools) are created:
+    cpu_set_t prev_cpus;
+    bool pinned = false;
+    if(!config.cpu_affinity.empty() &&
+       pthread_getaffinity_np(pthread_self(), sizeof(prev_cpus), &prev_cpus) == 0){
+
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for(int cpu : config.cpu_affinity){
+            if(0 <= cpu && cpu < CPU_SETSIZE){ CPU_SET(cpu, &cpus); }
+        }
+        pinned = (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0);
+    }
+
+    cppflow::defer restore_affinity([&](){
+        if(pinned){ pthread_setaffinity_np(pthread_self(), sizeof(prev_cpus), &prev_cpus); }
+    });
+
+    return cppflow::model(model_path, cppflow::model::TYPE::SAVED_MODEL,
+                          serialize_session_config(config));
+}
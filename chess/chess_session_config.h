@@ -0,0 +1,37 @@
+#ifndef CHESS_SESSION_CONFIG_H
+#define CHESS_SESSION_CONFIG_H
+
+#include <string>
+#include <vector>
+
+#include "cppflow/model.h"
+
+using namespace std;
+
+/**
+ * TensorFlow session threading options for a chessnet model.
+ *
+ *  By default, every session shares TensorFlow's process-wide thread pools
+ *  (sized to the number of cores), so several models running at once
+ *  oversubscribe the CPU. Sessions can instead be given their own pools
+ *  (isolate_pools), or sessions with the same inter_op_pool_name can share
+ *  a single named inter-op pool. If cpu_affinity is nonempty, the threads
+ *  created along with the session are pinned to the listed CPUs (pools that
+ *  already exist, such as the global pools after the first session has been
+ *  created, keep their affinity).
+ */
+struct chessnet_session_config {
+    int intra_op_threads = 0;       // (0: TensorFlow default)
+    int inter_op_threads = 0;       // (0: TensorFlow default)
+    bool isolate_pools = false;
+    string inter_op_pool_name = "";
+    vector<int> cpu_affinity;
+};
+
+// serializes the config as a tensorflow.ConfigProto message:
+string serialize_session_config(const chessnet_session_config& config);
+
+cppflow::model load_chessnet_model(const string& model_path,
+                        const chessnet_session_config& config = chessnet_session_config());
+
+#endif /* CHESS_SESSION_CONFIG_H */
@@ -65,7 +65,8 @@ class model {
   };  // enum TYPE
 
   explicit model(const std::string& filename,
-                 const TYPE type = TYPE::SAVED_MODEL);
+                 const TYPE type = TYPE::SAVED_MODEL,
+                 const std::string& session_config = "");
   model(const model &model) = default;
   model(model &&model) = default;
 
@@ -93,7 +94,8 @@ class model {
 
 namespace cppflow {
 
-inline model::model(const std::string &filename, const TYPE type) {
+inline model::model(const std::string &filename, const TYPE type,
+                    const std::string &session_config) {
   this->status = {TF_NewStatus(), &TF_DeleteStatus};
   this->graph = {TF_NewGraph(), TF_DeleteGraph};
 
@@ -101,6 +103,13 @@ inline model::model(const std::string &filename, const TYPE type) {
   std::unique_ptr<TF_SessionOptions, decltype(&TF_DeleteSessionOptions)>
       session_options = {TF_NewSessionOptions(), TF_DeleteSessionOptions};
 
+  // Apply a serialized ConfigProto (if any).
+  if (!session_config.empty()) {
+    TF_SetConfig(session_options.get(), session_config.data(),
+                 session_config.size(), this->status.get());
+    status_check(this->status.get());
+  }
+
   auto session_deleter = [this](TF_Session* sess) {
     TF_DeleteSession(sess, this->status.get());
     status_check(this->status.get());
@@ -0,0 +1,120 @@
+"""
+Exports the weights of a SimpleChessNet SavedModel (see "MCTS Chess Network.ipynb")
+to the native weights format read by ChessNativeNet (chess/chess_native_net.h).
+
+Batch normalization is folded into the preceding conv/dense layer, so the
+native forward pass only has to compute  act(x * W + b)  for each layer.
+
+The outputs of the SavedModel on a few sample boards are appended to the
+file as reference samples, and ChessNativeNet only loads the file if its own
+outputs match them (this checks the folding and the native layer layouts).
+
+Usage:
+    python export_native_weights.py <saved model dir> <output file>
+"""
+import sys
+import struct
+
+import numpy as np
+import tensorflow as tf
+
+MAGIC = b'CHESSNNW'
+VERSION = 1
+BN_EPSILON = 1e-3   # (keras BatchNormalization default)
+
+# checkpoint layer indices (in order of construction):
+CONV_LAYERS = [(0, 1), (2, 3), (4, 5), (6, 7)]  # (conv, batch norm)
+FC_LAYERS = [(8, 9), (10, 11)]                  # (dense, batch norm)
+PI_LAYER = 12
+V_LAYER = 13
+
+N_REFERENCE_SAMPLES = 16
+
+
+def sample_boards(n, seed=0):
+    """
+    Encodes the initial board and n-1 random boards, as in chess/chess_board_encoder.h:
+    x[y, x, plane] = +1 (white) or -1 (black), planes: pawn, rook, knight, bishop, queen, king
+    """
+    rng = np.random.default_rng(seed)
+    x = np.zeros((n, 8, 8, 6), dtype=np.float32)
+
+    back_rank = [1, 2, 3, 4, 5, 3, 2, 1]
+    x[0, 0, range(8), back_rank] = 1.0
+    x[0, 1, :, 0] = 1.0
+    x[0, 6, :, 0] = -1.0
+    x[0, 7, range(8), back_rank] = -1.0
+
+    for b in range(1, n):
+        squares = rng.permutation(64)[:rng.integers(2, 33)]
+        for k, square in enumerate(squares):
+            plane = 5 if k < 2 else rng.integers(0, 5)     # (one king of each color)
+            x[b, square // 8, square % 8, plane] = 1.0 if k % 2 == 0 else -1.0
+    return x
+
+
+def main(model_path, output_path):
+    reader = tf.train.load_checkpoint(model_path + '/variables/variables')
+
+    def var(layer, name):
+        key = 'model/model/layer_with_weights-{}/{}/.ATTRIBUTES/VARIABLE_VALUE'.format(layer, name)
+        return reader.get_tensor(key).astype(np.float32)
+
+    def fold(kernel_layer, bn_layer):
+        kernel = var(kernel_layer, 'kernel')
+        gamma = var(bn_layer, 'gamma')
+        beta = var(bn_layer, 'beta')
+        mean = var(bn_layer, 'moving_mean')
+        variance = var(bn_layer, 'moving_variance')
+
+        # BN(x*W) = (x*W - mean) * scale + beta, scale = gamma / sqrt(variance + eps)
+        scale = gamma / np.sqrt(variance + BN_EPSILON)
+        return kernel * scale, beta - mean * scale
+
+    tensors = []
+    for conv, bn in CONV_LAYERS:
+        tensors.extend(fold(conv, bn))
+    for fc, bn in FC_LAYERS:
+        tensors.extend(fold(fc, bn))
+    for layer in (PI_LAYER, V_LAYER):
+        tensors.extend([var(layer, 'kernel'), var(layer, 'bias')])
+
+    n_conv_channels = tensors[0].shape[3]
+    fc1_size = tensors[8].shape[1]
+    fc2_size = tensors[10].shape[1]
+    policy_size = tensors[12].shape[1]
+
+    # ensure the shapes match the native layout:
+    assert tensors[0].shape == (3, 3, 6, n_conv_channels)
+    for k in range(1, 4):
+        assert tensors[2*k].shape == (3, 3, n_conv_channels, n_conv_channels)
+    assert tensors[8].shape == (4*4*n_conv_channels, fc1_size)
+    assert tensors[10].shape == (fc1_size, fc2_size)
+    assert tensors[12].shape == (fc2_size, policy_size)
+    assert tensors[14].shape == (fc2_size, 1)
+
+    # reference outputs (of the serve function used by the C++ evaluator):
+    serve = tf.saved_model.load(model_path).signatures['chessnet_serve']
+    ref_x = sample_boards(N_REFERENCE_SAMPLES)
+    outputs = serve(x=tf.constant(ref_x))
+    ref_pi = outputs['output_0'].numpy()
+    ref_v = outputs['output_1'].numpy().reshape(-1)
+    assert ref_pi.shape == (N_REFERENCE_SAMPLES, policy_size)
+    assert ref_v.shape == (N_REFERENCE_SAMPLES,)
+
+    with open(output_path, 'wb') as f:
+        f.write(MAGIC)
+        f.write(struct.pack('=6I', VERSION, n_conv_channels, fc1_size, fc2_size, policy_size,
+                            N_REFERENCE_SAMPLES))
+        for t in tensors + [ref_x, ref_pi, ref_v]:
+            f.write(np.ascontiguousarray(t, dtype=np.float32).tobytes())
+
+    print('Exported {} parameters (and {} reference samples) to {}'.format(
+        sum(t.size for t in tensors), N_REFERENCE_SAMPLES, output_path))
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 3:
+        print(__doc__)
+        sys.exit(1)
+    main(sys.argv[1], sys.argv[2])
@@ -21,7 +21,7 @@ int main(){
     ChessNetSelfPlay self_play_instance = ChessNetSelfPlay("./jupyter/simple_chess_net");
     
     //self_play_instance.do_self_play_episode(1, dataset, cout, true);
-    //save_chessnet_dataset(dataset, "chessnet_data.mcts");
+    //append_chessnet_dataset_file(dataset, "chessnet_data.bin");
     
     //Perform training iterations on expert games:
     PGNLoader loader = PGNLoader("data/games.pgn");
@@ -6,22 +6,40 @@
 #include <map>
 #include <random>
 
+#include "mcts_stats.h"
+
 using namespace std;
 
+// (actions are stored when the node is expanded, so they are
+//  never regenerated when the search passes through the node.
+//  Terminal nodes have no actions and store their final value)
+template<typename D>
 struct MCTSNode {
 
     unsigned int visit_count;
+    bool terminal;
+    double terminal_value;
+    vector<D> actions;
     vector<double> prior;
     vector<unsigned int> action_counts;
     vector<unsigned int> action_q_values;
 
-    MCTSNode(vector<double>& prior){
+    MCTSNode(vector<D>& actions, vector<double>& prior){
         int n_actions = prior.size();
         this->visit_count = 0;
+        this->terminal = false;
+        this->terminal_value = 0.0;
+        this->actions = actions;
         this->prior = prior;
         this->action_counts = vector<unsigned int>(n_actions, 0);
         this->action_q_values = vector<unsigned int>(n_actions, 0);
     }
+
+    MCTSNode(double terminal_value){
+        this->visit_count = 0;
+        this->terminal = true;
+        this->terminal_value = terminal_value;
+    }
 };
 
 // S = state of MC search
@@ -32,11 +50,14 @@ protected:
     S state;
     double noise;
 
-    // TODO: do I really need to keep track of search path?
+    // path of the current simulation (actions applied, nodes and action indices selected):
     vector<D> search_path;
+    vector<MCTSNode<D>*> search_path_nodes;
     vector<int> search_path_indices;
-    unordered_map<size_t,MCTSNode> tree;
-    unordered_map<size_t,double> terminal_nodes;
+    unordered_map<size_t,MCTSNode<D>> tree;
+    size_t n_terminal_nodes;
+
+    MCTSStats stats;
 
 public:
 
@@ -46,7 +67,15 @@ public:
     virtual void undo_state_action(D d) = 0;
     virtual double get_final_state_value() = 0;
     virtual size_t hash_state() = 0;
-    virtual double action_objective_function(MCTSNode& node, int action) = 0;
+    virtual double action_objective_function(MCTSNode<D>& node, int action) = 0;
+
+    // called once at the start of each search (i.e. each call to run):
+    virtual void begin_search(){}
+
+    // called for each state reached below the root, before it is looked up in the tree.
+    // Returns true (and sets value) if the state is terminal because of the path taken
+    // to reach it (e.g. a repetition). These states are not cached in the tree:
+    virtual bool get_path_terminal_value(double& /*value*/){ return false; }
     
     MCTS(S& s);
 
@@ -60,6 +89,10 @@ public:
 
     S& get_state(){ return this->state; }
 
+    const MCTSStats& get_stats(){ return this->stats; }
+
+    void reset_stats(){ stats.reset(); }
+
 };
 
 // include implementation file:
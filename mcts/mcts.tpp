@@ -6,14 +6,17 @@
 #include <iostream>
 #include <algorithm>
 
+#include "util/timer.h"
+
 template<typename S, typename D>
 MCTS<S,D>::MCTS(S& s){
     this->state = s;
     
     this->search_path = vector<D>();
+    this->search_path_nodes = vector<MCTSNode<D>*>();
     this->search_path_indices = vector<int>();
-    this->tree = unordered_map<size_t,MCTSNode>();
-    this->terminal_nodes = unordered_map<size_t, double>();
+    this->tree = unordered_map<size_t,MCTSNode<D>>();
+    this->n_terminal_nodes = 0;
 }
 
 template<typename S, typename D>
@@ -25,14 +28,25 @@ void MCTS<S,D>::run(int n_simulations){
     vector<D> new_actions = vector<D>();
     vector<unsigned int> best_actions = vector<unsigned int>();
 
-    // record root and clear search tree:
+    // there is nothing to search from a terminal root (the root state is restored,
+    // since requesting its actions may set its final status):
+    if(tree.find(hash_state()) == tree.end()){
+        S unexpanded_root_state = state;
+        bool root_terminal = !get_state_actions(new_actions);
+        state = unexpanded_root_state;
+        if(root_terminal){ return; }
+    }
+
+    begin_search();
+    util::monotonic_stopwatch search_timer;
+
+#ifndef NDEBUG
+    // (each simulation must undo back to the root state)
     S root_state = state;
+#endif
     
     // perform n simulations:
     for(int n = 0; n < n_simulations; ++n){
-        
-        // inialize root state:
-        state = root_state;
 
         // begin searching for a leaf (or terminal) node:
         while(true){
@@ -40,6 +54,12 @@ void MCTS<S,D>::run(int n_simulations){
             new_actions.clear();
             new_probs.clear();
 
+            // check if the path to the state makes it terminal:
+            if(!search_path.empty() && get_path_terminal_value(value)){
+                ++stats.n_path_terminal_visits;
+                break;
+            }
+
             auto h = hash_state();
             auto tree_ptr = tree.find(h);
 
@@ -47,42 +67,43 @@ void MCTS<S,D>::run(int n_simulations){
             // check if the state is a leaf node:
             if(tree_ptr == tree.end()){
 
-                auto terminal_node_ptr = terminal_nodes.find(h);
-                if(terminal_node_ptr != terminal_nodes.end()){
-                    value = terminal_node_ptr->second;
-                } else if(get_state_actions(new_actions)){
+                if(get_state_actions(new_actions)){
                     value = get_state_action_estimates(new_actions, new_probs);
                     assert(new_actions.size() == new_probs.size());
-                    auto insertion = tree.emplace(h, new_probs);
-                    tree_ptr = insertion.first;
+                    tree.emplace(h, MCTSNode<D>(new_actions, new_probs));
+                    ++stats.n_expansions;
                 } else {
                     // handle if we've reached a new terminal state:
                     value = get_final_state_value();
-                    terminal_nodes.emplace(h, value);
+                    ++stats.n_terminal_visits;
+
+                    // (the root is not cached, as it may be terminal because of the path
+                    //  that led to it; below the root, these states are handled by
+                    //  get_path_terminal_value before the state actions are requested)
+                    if(!search_path.empty()){
+                        tree.emplace(h, MCTSNode<D>(value));
+                        ++n_terminal_nodes;
+                    }
                 }
                 break;
             }
-            
-            // recall previous prior estimates from cache:
-            if(get_state_actions(new_actions)){
-                new_probs = tree_ptr->second.prior;
-                assert((new_actions.size() == new_probs.size()) && "Note: possible hashing collision occurred!");
-            } else {
-                // set terminal state:
-                //     if this branch executes, then the simulation was cut short
-                //     (i.e. due to maximum recursion depth or "idling" rules)
-                value = get_final_state_value();
-                terminal_nodes.emplace(h, value);
+
+            // recall the terminal value (or actions) stored when the node was created:
+            MCTSNode<D>& node = tree_ptr->second;
+            if(node.terminal){
+                value = node.terminal_value;
+                ++stats.n_terminal_visits;
                 break;
             }
+            assert(node.actions.size() > 0);
 
             // select action that maximizes the action objective function (i.e. UCB):
             double best_obj = -1E+36;
             double obj;
             best_actions.clear();
 
-            for(unsigned int i = 0; i < new_actions.size(); ++i){
-                obj = action_objective_function(tree_ptr->second,i);
+            for(unsigned int i = 0; i < node.actions.size(); ++i){
+                obj = action_objective_function(node,i);
                 if(obj >= best_obj){
                     if(obj > best_obj){
                         best_actions.clear();
@@ -97,49 +118,58 @@ void MCTS<S,D>::run(int n_simulations){
             if(best_actions.size() > 1){ random_shuffle(best_actions.begin(),best_actions.end()); }
             
             unsigned int best_action = best_actions[0];
-            action = new_actions[best_action];
+            action = node.actions[best_action];
             search_path.push_back(action);
+            search_path_nodes.push_back(&node);
             search_path_indices.push_back(best_action);
             apply_state_action(action);
         }
 
-        // unwind search path and backpropagate Q values:
-        while(!search_path.empty()){
-            action = search_path.back();
-            int index = search_path_indices.back();
-            search_path.pop_back();
-            search_path_indices.pop_back();
-
-            undo_state_action(action);
-            auto h = hash_state();
-            auto tree_ptr = tree.find(h);
+        // record depth of the simulation:
+        stats.total_depth += search_path.size();
+        if(search_path.size() > stats.max_depth){ stats.max_depth = search_path.size(); }
 
-            assert(tree_ptr != tree.end());
+        // backpropagate Q values along the recorded path:
+        for(unsigned int i = 0; i < search_path_nodes.size(); ++i){
+            MCTSNode<D>& node = *search_path_nodes[i];
+            int index = search_path_indices[i];
 
-            // backpropagate Q values:
-            double action_q = tree_ptr->second.action_q_values[index];
-            double action_count = static_cast<double>(tree_ptr->second.action_counts[index]);
-            tree_ptr->second.action_q_values[index] = 
+            double action_q = node.action_q_values[index];
+            double action_count = static_cast<double>(node.action_counts[index]);
+            node.action_q_values[index] = 
                 (action_count*action_q + value) / 
                 (action_count + 1.0);
-            ++(tree_ptr->second.action_counts[index]);
-            ++(tree_ptr->second.visit_count);
+            ++(node.action_counts[index]);
+            ++(node.visit_count);
+        }
+        search_path_nodes.clear();
+        search_path_indices.clear();
+
+        // restore the root state:
+        while(!search_path.empty()){
+            undo_state_action(search_path.back());
+            search_path.pop_back();
         }
+        assert(state == root_state);
     }
 
-    state = root_state;
+    ++stats.n_searches;
+    stats.n_simulations += n_simulations;
+    stats.search_time += search_timer.elapsed_time<double, chrono::duration<double>>();
+    stats.tree_size = tree.size() - n_terminal_nodes;
+    stats.n_terminal_nodes = n_terminal_nodes;
 }
 
 template<typename S, typename D>
 void MCTS<S,D>::clear_cache(){
     tree.clear();
-    terminal_nodes.clear();
+    n_terminal_nodes = 0;
 }
 
 template<typename S, typename D>
 bool MCTS<S,D>::get_state_action_distribution(vector<double>& probs){
     auto tree_ptr = tree.find(hash_state());
-    if(tree_ptr == tree.end()){
+    if(tree_ptr == tree.end() || tree_ptr->second.terminal){
         return false;
     }
 
@@ -155,7 +185,7 @@ bool MCTS<S,D>::get_state_action_distribution(vector<double>& probs){
 template<typename S, typename D>
 bool MCTS<S,D>::get_state_action_Q_values(vector<double>& q_values){
     auto tree_ptr = tree.find(hash_state());
-    if(tree_ptr == tree.end()){
+    if(tree_ptr == tree.end() || tree_ptr->second.terminal){
         return false;
     }
 
@@ -0,0 +1,68 @@
+#ifndef MCTS_STATS_H
+#define MCTS_STATS_H
+
+#include <cstdint>
+#include <string>
+#include <sstream>
+
+#include <cereal/cereal.hpp>
+#include <cereal/archives/json.hpp>
+
+using namespace std;
+
+/**
+ * Search counters accumulated by MCTS::run (until reset):
+ *  depth is the number of actions applied from the root before a
+ *  simulation reached a leaf (or terminal) node.
+ */
+struct MCTSStats {
+    uint64_t n_searches = 0;
+    uint64_t n_simulations = 0;
+    uint64_t n_expansions = 0;
+    uint64_t n_terminal_visits = 0;
+    uint64_t n_path_terminal_visits = 0;    // (e.g. repetitions)
+    uint64_t total_depth = 0;
+    uint64_t max_depth = 0;
+    double search_time = 0.0;   // (seconds)
+
+    // (size of the search tree after the most recent search)
+    uint64_t tree_size = 0;
+    uint64_t n_terminal_nodes = 0;
+
+    double get_simulations_per_sec() const {
+        return (search_time > 0.0)? static_cast<double>(n_simulations) / search_time : 0.0;
+    }
+
+    double get_avg_depth() const {
+        return (n_simulations > 0)?
+            static_cast<double>(total_depth) / static_cast<double>(n_simulations) : 0.0;
+    }
+
+    void reset(){ *this = MCTSStats(); }
+
+    template<class Archive>
+    void save(Archive& ar) const {
+        ar(cereal::make_nvp("n_searches", n_searches),
+           cereal::make_nvp("n_simulations", n_simulations),
+           cereal::make_nvp("n_expansions", n_expansions),
+           cereal::make_nvp("n_terminal_visits", n_terminal_visits),
+           cereal::make_nvp("n_path_terminal_visits", n_path_terminal_visits),
+           cereal::make_nvp("search_time", search_time),
+           cereal::make_nvp("simulations_per_sec", get_simulations_per_sec()),
+           cereal::make_nvp("avg_depth", get_avg_depth()),
+           cereal::make_nvp("max_depth", max_depth),
+           cereal::make_nvp("tree_size", tree_size),
+           cereal::make_nvp("n_terminal_nodes", n_terminal_nodes));
+    }
+
+    string to_json() const {
+        stringstream ss;
+        {
+            cereal::JSONOutputArchive archive_out(ss);
+            save(archive_out);
+        }
+        return ss.str();
+    }
+};
+
+#endif // MCTS_STATS_H
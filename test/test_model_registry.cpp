@@ -0,0 +1,105 @@
+#include <iostream>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "chess/chess_game.h"
+#include "chess/chess_game_logic.h"
+#include "chess/chess_model_evaluator.h"
+
+using namespace std;
+
+/**
+ * Checks that saved models are published consistently (run with "make test_model_registry"):
+ * after ChessNetSelfPlay::save_model(), evaluators created from the model
+ * path get the same (new) version as the self-play model slot.
+ *
+ *  The model (jupyter/simple_chess_net_v3 by default) is copied to a
+ *  temporary directory first, since saving overwrites its weights.
+ */
+
+static int n_failures = 0;
+
+static void check(bool ok, const string& what){
+    if(!ok){
+        cerr << "FAILED: " << what << endl;
+        ++n_failures;
+    }
+}
+
+// value and priors of the initial position:
+static vector<double> evaluate_initial(ChessNetModelEvaluator& evaluator){
+    GameState gs;
+    auto actions = get_valid_moves(gs, WHITE);
+    vector<double> probs;
+    double value = evaluator.evaluate(gs, WHITE, actions, probs);
+    probs.push_back(value);
+    return probs;
+}
+
+// positions of random games, with uniform move probabilities and random values:
+static chessnet_dataset make_training_data(unsigned int n_items){
+    mt19937 rng(1234);
+    chessnet_dataset data;
+    GameState gs;
+    color player = WHITE;
+    while(data.size() < n_items){
+        auto moves = get_valid_moves(gs, player);
+        if(moves.empty()){
+            gs = GameState();
+            player = WHITE;
+            continue;
+        }
+        array<double,64*64> probs = {};
+        for(move_vector m : moves){
+            unsigned int move_idx = (src_y(m)<<9) | (src_x(m)<<6) | (dest_y(m)<<3) | dest_x(m);
+            probs[move_idx] = 1.0/moves.size();
+        }
+        data.emplace_back(gs.board, probs, (rng() & 1)? 1.0 : -1.0);
+        apply_move(gs, moves[rng() % moves.size()]);
+        player = !player;
+    }
+    return data;
+}
+
+int main(int argc, char** argv){
+
+    string source_path = (argc > 1)? argv[1] : "jupyter/simple_chess_net_v3";
+    string model_path = (filesystem::temp_directory_path() / "test_model_registry_model").string();
+    filesystem::remove_all(model_path);
+    filesystem::copy(source_path, model_path, filesystem::copy_options::recursive);
+
+    ChessNetSelfPlay selfplay(model_path);
+    auto& registry = get_chessnet_model_registry();
+
+    ChessNetModelEvaluator path_evaluator(model_path);
+    auto prev_outputs = evaluate_initial(path_evaluator);
+
+    chessnet_dataset data = make_training_data(64);
+    selfplay.do_training_steps(4, data, 0, cout);
+    selfplay.save_model();
+
+    // evaluators created from the path and from the slot see the new version:
+    ChessNetModelEvaluator new_path_evaluator(model_path);
+    ChessNetModelEvaluator slot_evaluator(selfplay.get_model_slot());
+    auto path_outputs = evaluate_initial(new_path_evaluator);
+    auto slot_outputs = evaluate_initial(slot_evaluator);
+
+    check(path_outputs == slot_outputs, "path and slot evaluators agree after save_model");
+    check(path_outputs != prev_outputs, "path evaluator sees the saved weights");
+    check(slot_evaluator.get_model_version() == 2, "slot version after save_model");
+    check(registry.size() == 1, "registry holds one model after save_model");
+
+    // (evaluators created before the save keep the previous version)
+    check(evaluate_initial(path_evaluator) == prev_outputs, "earlier evaluator keeps its version");
+
+    filesystem::remove_all(model_path);
+
+    if(n_failures){
+        cerr << n_failures << " check(s) failed." << endl;
+        return 1;
+    }
+    cout << "All model registry checks passed." << endl;
+    return 0;
+}
@@ -0,0 +1,295 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "chess/chess_game_state.h"
+#include "chess/chess_game_logic.h"
+#include "chess/chess_move_generator.h"
+
+using namespace std;
+
+/**
+ * Regression checks of the move logic (run with "make test_move_logic"):
+ *  - perft counts of positions with castling, en passant and promotions,
+ *    where each move is undone and the state must be restored exactly,
+ *  - random games (from the same positions), where the incremental state
+ *    (occupancy, piece counts, board key and check status) must match a
+ *    recomputation from the board, the staged generator must yield the
+ *    same moves as get_valid_moves (captures first), and every move must
+ *    round-trip through SAN parsing,
+ *  - positions with known move counts (e.g. pawns attacking from their start rank)
+ *    and known material draws.
+ */
+
+static int n_failures = 0;
+
+static void check(bool ok, const string& what){
+    if(!ok){
+        cerr << "FAILED: " << what << endl;
+        ++n_failures;
+    }
+}
+
+// a position given in FEN (only the board, player, castling and en passant fields are used):
+static GameState from_fen(const string& fen, color& player){
+    GameState gs;
+    for(int k = 0; k < 64; ++k){ gs.set_piece(k&7, k>>3, NONE); }
+    gs.state = 0;
+    gs.king_pos = 0;
+
+    const string PIECES = "PpRrNnBbQqKk";
+    size_t i = 0;
+    for(int y = 7, x = 0; i < fen.size() && fen[i] != ' '; ++i){
+        char c = fen[i];
+        if(c == '/'){ --y; x = 0; }
+        else if('1' <= c && c <= '8'){ x += c - '0'; }
+        else {
+            piece p = static_cast<piece>(W_PAWN + PIECES.find(c));
+            gs.set_piece(x, y, p);
+            if(p == W_KING){ set_w_king_pos(gs.king_pos, x, y); }
+            if(p == B_KING){ set_b_king_pos(gs.king_pos, x, y); }
+            ++x;
+        }
+    }
+
+    player = (fen[i+1] == 'b')? BLACK : WHITE;
+    for(i += 3; i < fen.size() && fen[i] != ' '; ++i){
+        if(fen[i] == 'K'){ set_w_can_rcastle(gs.state); }
+        if(fen[i] == 'Q'){ set_w_can_lcastle(gs.state); }
+        if(fen[i] == 'k'){ set_b_can_rcastle(gs.state); }
+        if(fen[i] == 'q'){ set_b_can_lcastle(gs.state); }
+    }
+    if(i+1 < fen.size() && fen[i+1] != '-'){
+        // (the en passant target square is behind the pawn that just moved two squares)
+        int x = fen[i+1] - 'a';
+        if(fen[i+2] == '3'){ set_w_en_passant_x(gs.state, x); }
+        else { set_b_en_passant_x(gs.state, x); }
+    }
+
+    if(is_checked(gs, w_king_x(gs.king_pos), w_king_y(gs.king_pos), BLACK)){ set_w_check(gs.state); }
+    if(is_checked(gs, b_king_x(gs.king_pos), b_king_y(gs.king_pos), WHITE)){ set_b_check(gs.state); }
+    return gs;
+}
+
+// a position with only the given pieces (without castling rights):
+static GameState make_position(const vector<pair<piece,string>>& pieces){
+    GameState gs;
+    for(int k = 0; k < 64; ++k){ gs.set_piece(k&7, k>>3, NONE); }
+    gs.state = 0;
+    gs.king_pos = 0;
+    for(auto& [p, sq] : pieces){
+        int x = sq[0]-'a', y = sq[1]-'1';
+        gs.set_piece(x, y, p);
+        if(p == W_KING){ set_w_king_pos(gs.king_pos, x, y); }
+        if(p == B_KING){ set_b_king_pos(gs.king_pos, x, y); }
+    }
+    return gs;
+}
+
+// recomputes the incremental data of the state from its board:
+static bool is_consistent(GameState& gs){
+    array<uint64_t,2> occupancy = {0, 0};
+    array<uint8_t,16> piece_counts = {};
+    uint64_t board_key = 0;
+    for(int k = 0; k < 64; ++k){
+        piece p = gs.board[k];
+        if(p){
+            occupancy[p & 1] |= (1ULL << k);
+            ++piece_counts[p];
+            board_key ^= ZOBRIST.pieces[p][k];
+        }
+    }
+    return occupancy == gs.occupancy && piece_counts == gs.piece_counts && board_key == gs.board_key;
+}
+
+// the check status set by apply_move matches a scan of the attacks on each king:
+static bool is_check_status_consistent(GameState& gs){
+    bool w_checked = is_checked(gs, w_king_x(gs.king_pos), w_king_y(gs.king_pos), BLACK);
+    bool b_checked = is_checked(gs, b_king_x(gs.king_pos), b_king_y(gs.king_pos), WHITE);
+    return w_check(gs.state) == w_checked && b_check(gs.state) == b_checked;
+}
+
+static uint64_t perft(GameState& gs, color player, int depth, move_undo_stack& undo){
+    auto moves = get_valid_moves(gs, player);
+    if(depth == 1){ return moves.size(); }
+
+    uint64_t n = 0;
+    for(move_vector m : moves){
+        GameState prev_gs = gs;
+        apply_move(gs, m, undo);
+        if(!is_consistent(gs)){
+            check(false, "incremental state after " + to_move_vector_string(m));
+            return 0;
+        }
+        n += perft(gs, !player, depth-1, undo);
+        undo_move(gs, m, undo);
+        if(!(gs == prev_gs) || !is_consistent(gs)){
+            check(false, "undo of " + to_move_vector_string(m));
+            return 0;
+        }
+    }
+    return n;
+}
+
+// the staged generator yields the same moves, with captures first (unless in check):
+static void check_staged_moves(GameState& gs, color player, vector<move_vector> moves, const string& where){
+    vector<move_vector> staged_moves;
+    StagedMoveGenerator gen(gs, player);
+    move_vector m;
+    while(gen.next(m)){ staged_moves.push_back(m); }
+
+    bool in_check = (player == WHITE)? w_check(gs.state) : b_check(gs.state);
+    if(!in_check){
+        auto is_capture = [&gs](move_vector v){ return captured_piece(gs, v) != NONE; };
+        check(is_partitioned(staged_moves.begin(), staged_moves.end(), is_capture),
+              "staged captures come first at " + where);
+    }
+
+    sort(moves.begin(), moves.end());
+    sort(staged_moves.begin(), staged_moves.end());
+    check(moves == staged_moves, "staged moves at " + where);
+}
+
+// SAN of a valid move (disambiguated by the origin file, then rank, only when needed):
+static string to_san(const GameState& gs, move_vector m, const vector<move_vector>& moves,
+                     bool disambiguate = true){
+    if(is_rcastle(m)){ return "O-O"; }
+    if(is_lcastle(m)){ return "O-O-O"; }
+
+    piece src_p = gs.get_piece(src_x(m), src_y(m));
+    bool capture = (captured_piece(gs, m) != NONE);
+    string san = to_char(src_p);
+    if(is_pawn(src_p)){
+        if(capture){ san += static_cast<char>('a' + src_x(m)); }
+    } else if(disambiguate){
+        bool ambiguous = false, same_file = false, same_rank = false;
+        for(move_vector v : moves){
+            if(v == m || is_castle(v) || dest_x(v) != dest_x(m) || dest_y(v) != dest_y(m) ||
+               gs.get_piece(src_x(v), src_y(v)) != src_p){ continue; }
+            ambiguous = true;
+            same_file |= (src_x(v) == src_x(m));
+            same_rank |= (src_y(v) == src_y(m));
+        }
+        if(ambiguous && (!same_file || same_rank)){ san += static_cast<char>('a' + src_x(m)); }
+        if(ambiguous && same_file){ san += static_cast<char>('1' + src_y(m)); }
+    }
+    if(capture){ san += "x"; }
+    san += pos_str(dest_x(m), dest_y(m));
+    if(promoted_piece(m)){ san += "=" + to_char(promoted_piece(m)); }
+    return san;
+}
+
+static void check_san_moves(GameState& gs, color player, const vector<move_vector>& moves, const string& where){
+    for(move_vector v : moves){
+        string san = to_san(gs, v, moves);
+        move_vector parsed;
+        check(parse_text_move(parsed, gs, player, san) && parsed == v, "SAN round-trip of " + san + " at " + where);
+
+        // (a move that needs disambiguation is rejected without it)
+        string bare_san = to_san(gs, v, moves, false);
+        if(bare_san != san){
+            check(!parse_text_move(parsed, gs, player, bare_san), "ambiguous SAN " + bare_san + " at " + where);
+        }
+    }
+}
+
+static void check_random_games(GameState start_gs, color start_player, unsigned int n_games,
+                               unsigned int seed, const string& name){
+    mt19937 rng(seed);
+
+    for(unsigned int g = 0; g < n_games; ++g){
+        GameState gs = start_gs;
+        color player = start_player;
+        for(int ply = 0; ply < 300; ++ply){
+            string where = name + " game " + to_string(g) + ", ply " + to_string(ply);
+            auto moves = get_valid_moves(gs, player);
+            if(moves.empty()){ break; }
+
+            check_staged_moves(gs, player, moves, where);
+            check_san_moves(gs, player, moves, where);
+
+            apply_move(gs, moves[rng() % moves.size()]);
+            check(is_consistent(gs), "incremental state at " + where);
+            check(is_check_status_consistent(gs), "check status at " + where);
+            player = !player;
+        }
+    }
+}
+
+struct perft_position {
+    string name;
+    string fen;
+    vector<uint64_t> counts;    // (by depth, from 1)
+};
+
+int main(){
+
+    const vector<perft_position> PERFT_POSITIONS = {
+        {"initial position", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -",
+            {20, 400, 8902, 197281}},
+        {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+            {48, 2039, 97862}},
+        {"position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -",
+            {14, 191, 2812, 43238}},
+        {"position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq -",
+            {6, 264, 9467}},
+        {"position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ -",
+            {44, 1486, 62379}},
+    };
+
+    for(auto& position : PERFT_POSITIONS){
+        color player;
+        GameState gs = from_fen(position.fen, player);
+        for(unsigned int depth = 1; depth <= position.counts.size(); ++depth){
+            move_undo_stack undo;
+            uint64_t n = perft(gs, player, depth, undo);
+            check(n == position.counts[depth-1],
+                  position.name + " perft " + to_string(depth) + " = " + to_string(n));
+        }
+        check_random_games(gs, player, 40, 1234, position.name);
+    }
+
+    // en passant is only possible right after the double step:
+    color player;
+    GameState gs = from_fen("4k3/8/8/8/3pP3/8/8/4K3 b - e3", player);
+    check(get_valid_moves(gs, BLACK).size() == 7, "black may capture en passant");
+    gs = from_fen("4k3/8/8/8/3pP3/8/8/4K3 b - -", player);
+    check(get_valid_moves(gs, BLACK).size() == 6, "black may not capture en passant later");
+
+    // captures are ordered by MVV-LVA (most valuable victim, then least valuable attacker):
+    gs = from_fen("4k3/8/8/3q1p2/4P3/8/8/3QK3 w - -", player);
+    StagedMoveGenerator gen(gs, WHITE);
+    vector<pair<string,string>> first_moves;
+    move_vector m;
+    for(int i = 0; i < 3 && gen.next(m); ++i){
+        first_moves.push_back({pos_str(src_x(m), src_y(m)), pos_str(dest_x(m), dest_y(m))});
+    }
+    check(first_moves == vector<pair<string,string>>({{"e4","d5"}, {"d1","d5"}, {"e4","f5"}}),
+          "MVV-LVA order of captures");
+
+    // pawns attack from their start rank (the king may not step to c6/e6 or c3/e3):
+    gs = make_position({{W_KING,"d5"}, {B_KING,"h8"}, {B_PAWN,"d7"}});
+    check(get_valid_moves(gs, WHITE).size() == 6, "white king next to an unmoved pawn");
+    gs = make_position({{B_KING,"d4"}, {W_KING,"h1"}, {W_PAWN,"d2"}});
+    check(get_valid_moves(gs, BLACK).size() == 6, "black king next to an unmoved pawn");
+
+    // material draws (from the piece counts):
+    check(has_insufficient_material(make_position({{W_KING,"a1"}, {B_KING,"h8"}})), "bare kings");
+    check(has_insufficient_material(make_position({{W_KING,"a1"}, {B_KING,"h8"}, {W_KNIGHT,"c3"}})),
+          "king and knight");
+    check(has_insufficient_material(make_position({{W_KING,"a1"}, {B_KING,"h8"}, {W_BISHOP,"c1"}, {B_BISHOP,"f4"}})),
+          "bishops on one square colour");
+    check(!has_insufficient_material(make_position({{W_KING,"a1"}, {B_KING,"h8"}, {W_BISHOP,"c1"}, {B_BISHOP,"f5"}})),
+          "bishops on both square colours");
+    check(!has_insufficient_material(make_position({{W_KING,"a1"}, {B_KING,"h8"}, {W_PAWN,"c2"}})),
+          "king and pawn");
+
+    if(n_failures){
+        cerr << n_failures << " check(s) failed." << endl;
+        return 1;
+    }
+    cout << "All move logic checks passed." << endl;
+    return 0;
+}
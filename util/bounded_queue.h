@@ -0,0 +1,66 @@
+#ifndef UTIL__BOUNDED_QUEUE_H
+#define UTIL__BOUNDED_QUEUE_H
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+/**
+    Blocking FIFO queue with a fixed capacity (for producer/consumer pipelines).
+    Once closed, push() fails and pop() drains the remaining items.
+*/
+
+namespace util {
+    template <typename T>
+    class bounded_queue {
+        std::deque<T> items;
+        size_t capacity;
+        bool closed;
+        std::mutex mtx;
+        std::condition_variable not_full, not_empty;
+
+    public:
+        explicit bounded_queue(size_t capacity) :
+            capacity(capacity > 0? capacity : 1), closed(false)
+        {}
+
+        // blocks while the queue is full; returns false if the queue was closed:
+        bool push(T item){
+            std::unique_lock<std::mutex> lock(mtx);
+            not_full.wait(lock, [this]{ return closed || items.size() < capacity; });
+            if(closed){ return false; }
+            items.push_back(std::move(item));
+            lock.unlock();
+            not_empty.notify_one();
+            return true;
+        }
+
+        // blocks while the queue is empty; returns false once closed and drained:
+        bool pop(T& item){
+            std::unique_lock<std::mutex> lock(mtx);
+            not_empty.wait(lock, [this]{ return closed || !items.empty(); });
+            if(items.empty()){ return false; }
+            item = std::move(items.front());
+            items.pop_front();
+            lock.unlock();
+            not_full.notify_one();
+            return true;
+        }
+
+        void close(){
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                closed = true;
+            }
+            not_full.notify_all();
+            not_empty.notify_all();
+        }
+
+        size_t size(){
+            std::lock_guard<std::mutex> lock(mtx);
+            return items.size();
+        }
+    };
+}
+
+#endif /* UTIL__BOUNDED_QUEUE_H */
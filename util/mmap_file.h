@@ -0,0 +1,101 @@
+#ifndef UTIL__MMAP_FILE_H
+#define UTIL__MMAP_FILE_H
+
+#include <string>
+#include <cstddef>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+    Read-only memory mapping of a file (POSIX mmap).
+    The mapping is released when the object is destroyed.
+*/
+
+namespace util {
+    class mmap_file {
+        const char* map_data;
+        size_t map_size;
+
+    public:
+        mmap_file() : map_data(nullptr), map_size(0) {}
+
+        explicit mmap_file(const std::string& path) : mmap_file() {
+            open(path);
+        }
+
+        mmap_file(const mmap_file&) = delete;
+        mmap_file& operator=(const mmap_file&) = delete;
+
+        mmap_file(mmap_file&& other) noexcept :
+            map_data(std::exchange(other.map_data, nullptr)),
+            map_size(std::exchange(other.map_size, 0))
+        {}
+
+        mmap_file& operator=(mmap_file&& other) noexcept {
+            if(this != &other){
+                close();
+                map_data = std::exchange(other.map_data, nullptr);
+                map_size = std::exchange(other.map_size, 0);
+            }
+            return *this;
+        }
+
+        ~mmap_file(){ close(); }
+
+        bool open(const std::string& path){
+            close();
+
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if(fd < 0){ return false; }
+
+            struct stat st;
+            if(fstat(fd, &st) != 0){
+                ::close(fd);
+                return false;
+            }
+
+            map_size = static_cast<size_t>(st.st_size);
+            if(map_size > 0){
+                void* addr = mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, 0);
+                if(addr == MAP_FAILED){
+                    map_size = 0;
+                    ::close(fd);
+                    return false;
+                }
+                map_data = static_cast<const char*>(addr);
+            }
+
+            // (the mapping stays valid after the descriptor is closed)
+            ::close(fd);
+            return true;
+        }
+
+        void close(){
+            if(map_data){
+                munmap(const_cast<char*>(map_data), map_size);
+            }
+            map_data = nullptr;
+            map_size = 0;
+        }
+
+        // hint that the mapping will be accessed in random order:
+        void advise_random() const {
+            if(map_data){ madvise(const_cast<char*>(map_data), map_size, MADV_RANDOM); }
+        }
+
+        // hint that the mapping will be read front to back:
+        void advise_sequential() const {
+            if(map_data){ madvise(const_cast<char*>(map_data), map_size, MADV_SEQUENTIAL); }
+        }
+
+        const char* data() const { return map_data; }
+        size_t size() const { return map_size; }
+        bool is_open() const { return map_data != nullptr; }
+    };
+}
+
+#endif /* UTIL__MMAP_FILE_H */
@@ -2,6 +2,7 @@
 #define UTIL__STRING_OPS_H
 
 #include <string>  
+#include <string_view>
 #include <vector> 
 #include <iostream>
 
@@ -22,6 +23,17 @@ namespace util {
 			j--;
 		return str.substr(i, j);
 	}
+
+	// strip() over a view (no copy is made):
+	inline std::string_view strip_view(std::string_view str, std::string_view ch=" "){
+		size_t i = 0;
+		while (i < str.size() && ch.find(str[i]) != std::string_view::npos)
+			i++;
+		size_t j = str.size();
+		while (j > i && ch.find(str[j-1]) != std::string_view::npos)
+			j--;
+		return str.substr(i, j-i);
+	}
 }
 
 #endif // UTIL__STRING_OPS_H
\ No newline at end of file